@@ -8,6 +8,7 @@
 
 // Big Endian helpers
 static WORD ReadU16BE(const BYTE* p) { return (p[0] << 8) | p[1]; }
+static DWORD ReadU24BE(const BYTE* p) { return (p[0] << 16) | (p[1] << 8) | p[2]; }
 static DWORD ReadU32BE(const BYTE* p) { return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
 static void WriteU16BE(BYTE* p, WORD v) {
     p[0] = (BYTE)((v >> 8) & 0xFF);
@@ -88,14 +89,13 @@ static bool GetFontOffsets(const BYTE* data, size_t size, std::vector<size_t>& o
 
 static DWORD CalcSfntChecksum(const BYTE* data, size_t length) {
     DWORD sum = 0;
-    for (size_t i = 0; i < length; i += 4) {
-        DWORD word = 0;
-        for (size_t j = 0; j < 4; ++j) {
-            word <<= 8;
-            if (i + j < length)
-                word |= data[i + j];
-        }
-        sum += word;
+    size_t whole = length & ~(size_t)3;
+    for (size_t i = 0; i < whole; i += 4)
+        sum += ReadU32BE(data + i);
+    if (whole < length) {
+        BYTE tail[4] = {};
+        memcpy(tail, data + whole, length - whole);
+        sum += ReadU32BE(tail);
     }
     return sum;
 }
@@ -111,40 +111,168 @@ static bool UpdateTableChecksumAt(BYTE* data, size_t size, size_t fontOffset, DW
     return true;
 }
 
+// The font checksum is the directory sum plus every table checksum. Patched
+// tables refresh their directory entry first, so the adjustment only reads the
+// directory instead of summing the whole file again.
 static bool UpdateChecksumAdjustmentAt(BYTE* data, size_t size, size_t fontOffset) {
     size_t headOffset = 0;
     size_t headLength = 0;
     if (!FindSfntTableAt(data, size, fontOffset, 0x68656164, &headOffset, &headLength)) return false; // 'head'
     if (headLength < 12) return false;
 
-    WriteU32BE(data + headOffset + 8, 0);
-    DWORD sum = IsFontCollection(data, size)
-        ? 0
-        : CalcSfntChecksum(data, size);
-    if (IsFontCollection(data, size)) {
-        WORD numTables = ReadU16BE(data + fontOffset + 4);
-        size_t dirLength = 12 + (size_t)numTables * 16;
-        if (fontOffset > size || dirLength > size - fontOffset) return false;
-        sum += CalcSfntChecksum(data + fontOffset, dirLength);
-        for (WORD i = 0; i < numTables; ++i) {
-            const BYTE* entry = data + fontOffset + 12 + (size_t)i * 16;
-            size_t tableOffset = ReadU32BE(entry + 8);
-            size_t tableLength = ReadU32BE(entry + 12);
-            if (tableOffset > size || tableLength > size - tableOffset) return false;
-            sum += CalcSfntChecksum(data + tableOffset, tableLength);
+    WORD numTables = ReadU16BE(data + fontOffset + 4);
+    size_t dirLength = 12 + (size_t)numTables * 16;
+    if (dirLength > size - fontOffset) return false;
+
+    DWORD sum = CalcSfntChecksum(data + fontOffset, dirLength);
+    for (WORD i = 0; i < numTables; ++i)
+        sum += ReadU32BE(data + fontOffset + 12 + (size_t)i * 16 + 4);
+    WriteU32BE(data + headOffset + 8, 0xB1B0AFBAu - sum);
+    return true;
+}
+
+static void AlignSfntBuffer(std::vector<BYTE>& data) {
+    while ((data.size() & 3) != 0)
+        data.push_back(0);
+}
+
+bool FontPatcher::SfntTableBuilder::Load(const BYTE* data, size_t size, size_t fontOffset,
+    bool recomputeChecksums) {
+    version_ = 0;
+    recomputeChecksums_ = recomputeChecksums;
+    tables_.clear();
+    if (!data || fontOffset > size || size - fontOffset < 12) return false;
+    DWORD version = ReadU32BE(data + fontOffset);
+    if (!IsSfntVersion(version)) return false;
+
+    WORD numTables = ReadU16BE(data + fontOffset + 4);
+    if (numTables == 0 || numTables > 256) return false;
+    size_t sourceDir = fontOffset + 12;
+    if (sourceDir + (size_t)numTables * 16 > size) return false;
+
+    tables_.reserve((size_t)numTables + 1);
+    for (WORD i = 0; i < numTables; ++i) {
+        const BYTE* record = data + sourceDir + (size_t)i * 16;
+        Table table = {};
+        table.tag = ReadU32BE(record + 0);
+        table.checksum = ReadU32BE(record + 4);
+        size_t offset = ReadU32BE(record + 8);
+        table.length = ReadU32BE(record + 12);
+        if (offset > size || table.length > size - offset) {
+            tables_.clear();
+            return false;
         }
+        table.source = data + offset;
+        tables_.push_back(std::move(table));
     }
-    WriteU32BE(data + headOffset + 8, 0xB1B0AFBAu - sum);
+
+    // Some fonts list their tables in file order. Write emits the directory in
+    // vector order and ReplaceTable inserts by tag, so both need it sorted.
+    std::stable_sort(tables_.begin(), tables_.end(),
+        [](const Table& left, const Table& right) { return left.tag < right.tag; });
+
+    version_ = version;
     return true;
 }
 
-static bool UpdateChecksumAdjustment(BYTE* data, size_t size) {
-    return UpdateChecksumAdjustmentAt(data, size, 0);
+const BYTE* FontPatcher::SfntTableBuilder::FindTable(DWORD tag, size_t* length) const {
+    for (const Table& table : tables_) {
+        if (table.tag != tag) continue;
+        if (length) *length = table.replaced ? table.replacement.size() : table.length;
+        return table.replaced ? table.replacement.data() : table.source;
+    }
+    if (length) *length = 0;
+    return NULL;
+}
+
+bool FontPatcher::SfntTableBuilder::ReplaceTable(DWORD tag, std::vector<BYTE>&& table) {
+    if (!version_ || table.size() > 0xFFFFFFFFu) return false;
+
+    size_t index = 0;
+    while (index < tables_.size() && tables_[index].tag < tag) ++index;
+    if (index == tables_.size() || tables_[index].tag != tag) {
+        if (tables_.size() >= 256) return false;
+        Table added = {};
+        added.tag = tag;
+        tables_.insert(tables_.begin() + index, std::move(added));
+    }
+
+    Table& entry = tables_[index];
+    entry.replacement = std::move(table);
+    entry.source = NULL;
+    entry.length = entry.replacement.size();
+    entry.replaced = true;
+    return true;
 }
 
-static bool UpdateChecksumAdjustment(std::vector<BYTE>& data) {
-    if (data.empty()) return false;
-    return UpdateChecksumAdjustment(data.data(), data.size());
+bool FontPatcher::SfntTableBuilder::RemoveTable(DWORD tag) {
+    for (size_t i = 0; i < tables_.size(); ++i) {
+        if (tables_[i].tag != tag) continue;
+        tables_.erase(tables_.begin() + i);
+        return true;
+    }
+    return false;
+}
+
+bool FontPatcher::SfntTableBuilder::Write(std::vector<BYTE>& outFontData) const {
+    outFontData.clear();
+    if (!version_ || tables_.empty()) return false;
+
+    WORD numTables = (WORD)tables_.size();
+    size_t dirSize = 12 + (size_t)numTables * 16;
+    unsigned long long total = dirSize;
+    for (const Table& table : tables_)
+        total = ((total + 3) & ~3ull) + table.length;
+    total = (total + 3) & ~3ull;
+    if (total > 0xFFFFFFFFull) return false;
+
+    outFontData.reserve((size_t)total);
+    outFontData.assign(dirSize, 0);
+    WriteU32BE(outFontData.data(), version_);
+    WriteU16BE(outFontData.data() + 4, numTables);
+    WORD maxPower = 1;
+    WORD entrySelector = 0;
+    while ((WORD)(maxPower * 2) <= numTables) {
+        maxPower = (WORD)(maxPower * 2);
+        ++entrySelector;
+    }
+    WORD searchRange = (WORD)(maxPower * 16);
+    WORD rangeShift = (WORD)(numTables * 16 - searchRange);
+    WriteU16BE(outFontData.data() + 6, searchRange);
+    WriteU16BE(outFontData.data() + 8, entrySelector);
+    WriteU16BE(outFontData.data() + 10, rangeShift);
+
+    DWORD tableSum = 0;
+    size_t headOffset = 0;
+    for (WORD i = 0; i < numTables; ++i) {
+        const Table& table = tables_[i];
+        const BYTE* bytes = table.replaced ? table.replacement.data() : table.source;
+        size_t destOffset = outFontData.size();
+        outFontData.insert(outFontData.end(), bytes, bytes + table.length);
+        AlignSfntBuffer(outFontData);
+
+        DWORD checksum = table.checksum;
+        if (table.tag == 0x68656164 && table.length >= 12) { // 'head'
+            WriteU32BE(outFontData.data() + destOffset + 8, 0);
+            headOffset = destOffset;
+            checksum = CalcSfntChecksum(outFontData.data() + destOffset, table.length);
+        } else if (table.replaced || recomputeChecksums_) {
+            checksum = CalcSfntChecksum(outFontData.data() + destOffset, table.length);
+        }
+        tableSum += checksum;
+
+        BYTE* record = outFontData.data() + 12 + (size_t)i * 16;
+        WriteU32BE(record + 0, table.tag);
+        WriteU32BE(record + 4, checksum);
+        WriteU32BE(record + 8, (DWORD)destOffset);
+        WriteU32BE(record + 12, (DWORD)table.length);
+    }
+
+    if (headOffset) {
+        DWORD sum = CalcSfntChecksum(outFontData.data(), dirSize) + tableSum;
+        WriteU32BE(outFontData.data() + headOffset + 8, 0xB1B0AFBAu - sum);
+    }
+    return true;
 }
 
 static int ClampIntLocal(int value, int lo, int hi) {
@@ -171,6 +299,12 @@ static void AppendU16BE(std::vector<BYTE>& data, WORD value) {
     data.push_back((BYTE)(value & 0xFF));
 }
 
+static void AppendU24BE(std::vector<BYTE>& data, DWORD value) {
+    data.push_back((BYTE)((value >> 16) & 0xFF));
+    data.push_back((BYTE)((value >> 8) & 0xFF));
+    data.push_back((BYTE)(value & 0xFF));
+}
+
 static void AppendU32BE(std::vector<BYTE>& data, DWORD value) {
     data.push_back((BYTE)((value >> 24) & 0xFF));
     data.push_back((BYTE)((value >> 16) & 0xFF));
@@ -348,80 +482,9 @@ static bool CollectionFontMatchesFace(const BYTE* data, size_t size, size_t font
 static bool ExtractSfntAtOffset(const BYTE* data, size_t size, size_t fontOffset,
     std::vector<BYTE>& outFontData) {
     outFontData.clear();
-    if (!data || fontOffset > size || size - fontOffset < 12) return false;
-    DWORD version = ReadU32BE(data + fontOffset);
-    if (!IsSfntVersion(version)) return false;
-
-    WORD numTables = ReadU16BE(data + fontOffset + 4);
-    if (numTables == 0 || numTables > 256) return false;
-
-    size_t sourceDir = fontOffset + 12;
-    if (sourceDir + (size_t)numTables * 16 > size) return false;
-
-    struct TableRecord {
-        DWORD tag;
-        size_t offset;
-        size_t length;
-    };
-    std::vector<TableRecord> tables;
-    tables.reserve(numTables);
-    for (WORD i = 0; i < numTables; ++i) {
-        const BYTE* record = data + sourceDir + (size_t)i * 16;
-        TableRecord table = {};
-        table.tag = ReadU32BE(record + 0);
-        table.offset = ReadU32BE(record + 8);
-        table.length = ReadU32BE(record + 12);
-        if (table.offset > size || table.length > size - table.offset) return false;
-        tables.push_back(table);
-    }
-
-    size_t dirSize = 12 + (size_t)numTables * 16;
-    outFontData.assign(dirSize, 0);
-
-    WriteU32BE(outFontData.data(), version);
-    WriteU16BE(outFontData.data() + 4, numTables);
-    WORD maxPower = 1;
-    WORD entrySelector = 0;
-    while ((WORD)(maxPower * 2) <= numTables) {
-        maxPower = (WORD)(maxPower * 2);
-        ++entrySelector;
-    }
-    WORD searchRange = (WORD)(maxPower * 16);
-    WORD rangeShift = (WORD)(numTables * 16 - searchRange);
-    WriteU16BE(outFontData.data() + 6, searchRange);
-    WriteU16BE(outFontData.data() + 8, entrySelector);
-    WriteU16BE(outFontData.data() + 10, rangeShift);
-
-    for (WORD i = 0; i < numTables; ++i) {
-        size_t alignedOffset = (outFontData.size() + 3) & ~(size_t)3;
-        if (alignedOffset > outFontData.size())
-            outFontData.insert(outFontData.end(), alignedOffset - outFontData.size(), 0);
-
-        size_t destOffset = outFontData.size();
-        const TableRecord& table = tables[i];
-        outFontData.insert(outFontData.end(), data + table.offset, data + table.offset + table.length);
-        while ((outFontData.size() & 3) != 0)
-            outFontData.push_back(0);
-
-        BYTE* record = outFontData.data() + 12 + (size_t)i * 16;
-        WriteU32BE(record + 0, table.tag);
-        WriteU32BE(record + 4, 0);
-        WriteU32BE(record + 8, (DWORD)destOffset);
-        WriteU32BE(record + 12, (DWORD)table.length);
-    }
-
-    size_t headOffset = 0;
-    size_t headLength = 0;
-    if (FindSfntTableAt(outFontData.data(), outFontData.size(), 0, 0x68656164,
-        &headOffset, &headLength) && headLength >= 12) {
-        WriteU32BE(outFontData.data() + headOffset + 8, 0);
-    }
-
-    for (const TableRecord& table : tables)
-        UpdateTableChecksumAt(outFontData.data(), outFontData.size(), 0, table.tag);
-    UpdateChecksumAdjustment(outFontData);
-
-    return IsSfntVersion(ReadU32BE(outFontData.data()));
+    FontPatcher::SfntTableBuilder builder;
+    if (!builder.Load(data, size, fontOffset, true)) return false;
+    return builder.Write(outFontData);
 }
 
 static bool NormalizeGdiSfntData(std::vector<BYTE>& fontData) {
@@ -475,7 +538,85 @@ static bool NormalizeGdiSfntData(std::vector<BYTE>& fontData) {
     return false;
 }
 
-static bool DecodeCmapFormat4Bmp(const BYTE* subtable, size_t length, std::vector<WORD>& glyphs) {
+// Unicode cmaps are held as sorted, non-overlapping delta ranges: every code
+// point in [start, end] maps to startGlyph + (cp - start). Decoding, patching
+// and encoding scale with the number of ranges rather than the code space.
+struct CmapRange {
+    DWORD start;
+    DWORD end;
+    DWORD startGlyph;
+};
+
+// One format 14 selector. Default UVS entries resolve through the base cmap;
+// non-default entries carry their own glyph.
+struct CmapVariationSelector {
+    DWORD selector;
+    std::vector<std::pair<DWORD, DWORD>> defaultRanges;    // first, last code point
+    std::vector<std::pair<DWORD, WORD>> mappings;           // code point, glyph
+};
+
+struct UnicodeCmap {
+    std::vector<CmapRange> ranges;
+    std::vector<CmapVariationSelector> variations;
+};
+
+static const DWORD kMaxUnicodeCodepoint = 0x10FFFF;
+
+// Appends in code point order, merging with the previous range when the glyph
+// sequence continues. A leading glyph 0 is unmapped and skipped.
+static void AppendCmapRange(std::vector<CmapRange>& ranges, DWORD start, DWORD end, DWORD startGlyph) {
+    if (startGlyph == 0) {
+        if (start == end) return;
+        ++start;
+        startGlyph = 1;
+    }
+    if (!ranges.empty()) {
+        CmapRange& last = ranges.back();
+        if (last.end + 1 == start && last.startGlyph + (start - last.start) == startGlyph) {
+            last.end = end;
+            return;
+        }
+    }
+    CmapRange range = { start, end, startGlyph };
+    ranges.push_back(range);
+}
+
+// Broken fonts can list overlapping or unsorted segments; the first mapping of
+// a code point wins, as in a sequential lookup.
+static void NormalizeCmapRanges(std::vector<CmapRange>& ranges) {
+    std::stable_sort(ranges.begin(), ranges.end(), [](const CmapRange& a, const CmapRange& b) {
+        return a.start < b.start;
+    });
+    std::vector<CmapRange> normalized;
+    normalized.reserve(ranges.size());
+    for (const CmapRange& range : ranges) {
+        DWORD start = range.start;
+        if (!normalized.empty() && normalized.back().end >= start) {
+            if (normalized.back().end >= range.end) continue;
+            start = normalized.back().end + 1;
+        }
+        AppendCmapRange(normalized, start, range.end, range.startGlyph + (start - range.start));
+    }
+    ranges.swap(normalized);
+}
+
+static WORD LookupCmapGlyph(const std::vector<CmapRange>& ranges, DWORD codepoint) {
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), codepoint,
+        [](DWORD value, const CmapRange& range) { return value < range.start; });
+    if (it == ranges.begin()) return 0;
+    --it;
+    if (codepoint > it->end) return 0;
+    return (WORD)(it->startGlyph + (codepoint - it->start));
+}
+
+static size_t CountCmapCodepoints(const std::vector<CmapRange>& ranges) {
+    size_t count = 0;
+    for (const CmapRange& range : ranges) count += (size_t)(range.end - range.start) + 1;
+    return count;
+}
+
+static bool DecodeCmapFormat4(const BYTE* subtable, size_t length, std::vector<CmapRange>& ranges) {
+    ranges.clear();
     if (!subtable || length < 16 || ReadU16BE(subtable) != 4) return false;
     WORD subLength = ReadU16BE(subtable + 2);
     if (subLength < 16 || subLength > length) return false;
@@ -494,35 +635,42 @@ static bool DecodeCmapFormat4Bmp(const BYTE* subtable, size_t length, std::vecto
     size_t glyphArrayOffset = rangeOffset + (size_t)segCount * 2;
     if (glyphArrayOffset > length) return false;
 
-    bool any = false;
     for (WORD i = 0; i < segCount; ++i) {
-        WORD endCode = ReadU16BE(subtable + endOffset + (size_t)i * 2);
-        WORD startCode = ReadU16BE(subtable + startOffset + (size_t)i * 2);
-        SHORT idDelta = (SHORT)ReadU16BE(subtable + deltaOffset + (size_t)i * 2);
+        DWORD endCode = ReadU16BE(subtable + endOffset + (size_t)i * 2);
+        DWORD startCode = ReadU16BE(subtable + startOffset + (size_t)i * 2);
+        WORD idDelta = ReadU16BE(subtable + deltaOffset + (size_t)i * 2);
         WORD idRangeOffset = ReadU16BE(subtable + rangeOffset + (size_t)i * 2);
+        if (endCode == 0xFFFF) endCode = 0xFFFE;
         if (startCode > endCode) continue;
 
-        for (DWORD ch = startCode; ch <= endCode && ch < 0xFFFF; ++ch) {
-            WORD glyph = 0;
-            if (idRangeOffset == 0) {
-                glyph = (WORD)((ch + idDelta) & 0xFFFF);
+        if (idRangeOffset == 0) {
+            // Glyph ids wrap modulo 65536; the code point landing on 0 is unmapped.
+            DWORD firstGlyph = (startCode + idDelta) & 0xFFFF;
+            DWORD wrapAt = startCode + (0x10000 - firstGlyph);
+            if (firstGlyph == 0 || wrapAt > endCode) {
+                AppendCmapRange(ranges, startCode, endCode, firstGlyph);
             } else {
-                size_t rangeWordOffset = rangeOffset + (size_t)i * 2;
-                size_t glyphOffset = rangeWordOffset + idRangeOffset + (size_t)(ch - startCode) * 2;
-                if (glyphOffset + 2 > length) continue;
-                glyph = ReadU16BE(subtable + glyphOffset);
-                if (glyph != 0) glyph = (WORD)((glyph + idDelta) & 0xFFFF);
-            }
-            if (glyph != 0) {
-                glyphs[(size_t)ch] = glyph;
-                any = true;
+                if (wrapAt > startCode) AppendCmapRange(ranges, startCode, wrapAt - 1, firstGlyph);
+                if (wrapAt < endCode) AppendCmapRange(ranges, wrapAt + 1, endCode, 1);
             }
+            continue;
+        }
+
+        size_t rangeWordOffset = rangeOffset + (size_t)i * 2;
+        for (DWORD ch = startCode; ch <= endCode; ++ch) {
+            size_t glyphOffset = rangeWordOffset + idRangeOffset + (size_t)(ch - startCode) * 2;
+            if (glyphOffset + 2 > length) break;
+            WORD glyph = ReadU16BE(subtable + glyphOffset);
+            if (glyph != 0) glyph = (WORD)((glyph + idDelta) & 0xFFFF);
+            if (glyph != 0) AppendCmapRange(ranges, ch, ch, glyph);
         }
     }
-    return any;
+    NormalizeCmapRanges(ranges);
+    return !ranges.empty();
 }
 
-static bool DecodeCmapFormat12Bmp(const BYTE* subtable, size_t length, std::vector<WORD>& glyphs) {
+static bool DecodeCmapFormat12(const BYTE* subtable, size_t length, std::vector<CmapRange>& ranges) {
+    ranges.clear();
     if (!subtable || length < 16 || ReadU16BE(subtable) != 12) return false;
     DWORD subLength = ReadU32BE(subtable + 4);
     if (subLength < 16 || subLength > length) return false;
@@ -531,23 +679,59 @@ static bool DecodeCmapFormat12Bmp(const BYTE* subtable, size_t length, std::vect
     DWORD groupCount = ReadU32BE(subtable + 12);
     if (groupCount > (length - 16) / 12) return false;
 
-    bool any = false;
+    ranges.reserve(groupCount);
     for (DWORD i = 0; i < groupCount; ++i) {
         const BYTE* group = subtable + 16 + (size_t)i * 12;
         DWORD startChar = ReadU32BE(group + 0);
-        DWORD endChar = ReadU32BE(group + 4);
+        DWORD endChar = std::min<DWORD>(ReadU32BE(group + 4), kMaxUnicodeCodepoint);
         DWORD startGlyph = ReadU32BE(group + 8);
-        if (startChar > endChar || startChar > 0xFFFF) continue;
-
-        DWORD end = std::min<DWORD>(endChar, 0xFFFE);
-        for (DWORD ch = startChar; ch <= end; ++ch) {
-            DWORD glyph = startGlyph + (ch - startChar);
-            if (glyph == 0 || glyph > 0xFFFF) continue;
-            glyphs[(size_t)ch] = (WORD)glyph;
-            any = true;
+        if (startChar > endChar || startGlyph > 0xFFFF) continue;
+        if (endChar - startChar > 0xFFFF - startGlyph) endChar = startChar + (0xFFFF - startGlyph);
+        AppendCmapRange(ranges, startChar, endChar, startGlyph);
+    }
+    NormalizeCmapRanges(ranges);
+    return !ranges.empty();
+}
+
+static bool DecodeCmapFormat14(const BYTE* subtable, size_t length,
+    std::vector<CmapVariationSelector>& variations) {
+    variations.clear();
+    if (!subtable || length < 10 || ReadU16BE(subtable) != 14) return false;
+    DWORD subLength = ReadU32BE(subtable + 2);
+    if (subLength < 10 || subLength > length) return false;
+    length = subLength;
+
+    DWORD recordCount = ReadU32BE(subtable + 6);
+    if (recordCount > (length - 10) / 11) return false;
+    for (DWORD i = 0; i < recordCount; ++i) {
+        const BYTE* record = subtable + 10 + (size_t)i * 11;
+        CmapVariationSelector item;
+        item.selector = ReadU24BE(record);
+        DWORD defaultOffset = ReadU32BE(record + 3);
+        DWORD nonDefaultOffset = ReadU32BE(record + 7);
+
+        if (defaultOffset && defaultOffset <= length - 4) {
+            DWORD count = ReadU32BE(subtable + defaultOffset);
+            if (count <= (length - defaultOffset - 4) / 4) {
+                for (DWORD j = 0; j < count; ++j) {
+                    const BYTE* range = subtable + defaultOffset + 4 + (size_t)j * 4;
+                    DWORD first = ReadU24BE(range);
+                    item.defaultRanges.push_back(std::make_pair(first, first + range[3]));
+                }
+            }
+        }
+        if (nonDefaultOffset && nonDefaultOffset <= length - 4) {
+            DWORD count = ReadU32BE(subtable + nonDefaultOffset);
+            if (count <= (length - nonDefaultOffset - 4) / 5) {
+                for (DWORD j = 0; j < count; ++j) {
+                    const BYTE* mapping = subtable + nonDefaultOffset + 4 + (size_t)j * 5;
+                    item.mappings.push_back(std::make_pair(ReadU24BE(mapping), ReadU16BE(mapping + 3)));
+                }
+            }
         }
+        variations.push_back(std::move(item));
     }
-    return any;
+    return !variations.empty();
 }
 
 static int UnicodeCmapRecordScore(WORD platformId, WORD encodingId, WORD format) {
@@ -562,17 +746,9 @@ static int UnicodeCmapRecordScore(WORD platformId, WORD encodingId, WORD format)
     return 0;
 }
 
-static size_t CountMappedBmpGlyphs(const std::vector<WORD>& glyphs) {
-    size_t count = 0;
-    for (WORD glyph : glyphs) {
-        if (glyph != 0) ++count;
-    }
-    return count;
-}
-
-static bool CollectBestUnicodeCmapBmp(const BYTE* data, size_t size, size_t fontOffset,
-    std::vector<WORD>& glyphs) {
-    glyphs.assign(65536, 0);
+static bool CollectBestUnicodeCmap(const BYTE* data, size_t size, size_t fontOffset, UnicodeCmap& cmapOut) {
+    cmapOut.ranges.clear();
+    cmapOut.variations.clear();
 
     size_t cmapOffset = 0;
     size_t cmapLength = 0;
@@ -586,7 +762,7 @@ static bool CollectBestUnicodeCmapBmp(const BYTE* data, size_t size, size_t font
 
     int bestScore = 0;
     size_t bestCount = 0;
-    std::vector<WORD> bestGlyphs(65536, 0);
+    std::vector<CmapRange> decoded;
     for (WORD i = 0; i < recordCount; ++i) {
         const BYTE* record = cmap + 4 + (size_t)i * 8;
         WORD platformId = ReadU16BE(record + 0);
@@ -596,60 +772,142 @@ static bool CollectBestUnicodeCmapBmp(const BYTE* data, size_t size, size_t font
 
         const BYTE* subtable = cmap + offset;
         WORD format = ReadU16BE(subtable);
+        if (platformId == 0 && encodingId == 5 && format == 14) {
+            DecodeCmapFormat14(subtable, cmapLength - offset, cmapOut.variations);
+            continue;
+        }
+
         int score = UnicodeCmapRecordScore(platformId, encodingId, format);
-        if (score == 0) continue;
+        if (score == 0 || score < bestScore) continue;
 
-        std::vector<WORD> decoded(65536, 0);
         bool ok = format == 12
-            ? DecodeCmapFormat12Bmp(subtable, cmapLength - offset, decoded)
-            : DecodeCmapFormat4Bmp(subtable, cmapLength - offset, decoded);
+            ? DecodeCmapFormat12(subtable, cmapLength - offset, decoded)
+            : DecodeCmapFormat4(subtable, cmapLength - offset, decoded);
         if (!ok) continue;
 
-        size_t decodedCount = CountMappedBmpGlyphs(decoded);
-        if (score > bestScore || (score == bestScore && decodedCount > bestCount)) {
+        size_t decodedCount = CountCmapCodepoints(decoded);
+        if (score > bestScore || decodedCount > bestCount) {
             bestScore = score;
             bestCount = decodedCount;
-            bestGlyphs.swap(decoded);
+            cmapOut.ranges.swap(decoded);
         }
     }
+    return bestCount != 0;
+}
 
-    if (bestCount == 0) return false;
-    glyphs.swap(bestGlyphs);
-    return true;
+struct CmapOverride {
+    DWORD codepoint;
+    DWORD glyph;
+};
+
+// Splits the ranges around each override. Overrides must be sorted and unique.
+static void ApplyCmapOverrides(std::vector<CmapRange>& ranges, const std::vector<CmapOverride>& overrides) {
+    std::vector<CmapRange> merged;
+    merged.reserve(ranges.size() + overrides.size() * 2);
+    size_t next = 0;
+    for (const CmapRange& range : ranges) {
+        while (next < overrides.size() && overrides[next].codepoint < range.start) {
+            AppendCmapRange(merged, overrides[next].codepoint, overrides[next].codepoint, overrides[next].glyph);
+            ++next;
+        }
+        DWORD cursor = range.start;
+        while (next < overrides.size() && overrides[next].codepoint <= range.end) {
+            DWORD codepoint = overrides[next].codepoint;
+            if (codepoint > cursor)
+                AppendCmapRange(merged, cursor, codepoint - 1, range.startGlyph + (cursor - range.start));
+            AppendCmapRange(merged, codepoint, codepoint, overrides[next].glyph);
+            cursor = codepoint + 1;
+            ++next;
+        }
+        if (cursor <= range.end)
+            AppendCmapRange(merged, cursor, range.end, range.startGlyph + (cursor - range.start));
+    }
+    for (; next < overrides.size(); ++next)
+        AppendCmapRange(merged, overrides[next].codepoint, overrides[next].codepoint, overrides[next].glyph);
+    ranges.swap(merged);
+}
+
+static bool CmapDefaultRangesContain(const std::vector<std::pair<DWORD, DWORD>>& ranges, DWORD codepoint) {
+    for (const auto& range : ranges) {
+        if (codepoint >= range.first && codepoint <= range.second) return true;
+    }
+    return false;
+}
+
+// Makes `from` follow every variation sequence defined for `to`.
+static void AliasCmapVariations(std::vector<CmapVariationSelector>& variations, DWORD from, DWORD to) {
+    for (CmapVariationSelector& item : variations) {
+        std::vector<std::pair<DWORD, DWORD>> ranges;
+        for (const auto& range : item.defaultRanges) {
+            if (from < range.first || from > range.second) {
+                ranges.push_back(range);
+                continue;
+            }
+            if (from > range.first) ranges.push_back(std::make_pair(range.first, from - 1));
+            if (from < range.second) ranges.push_back(std::make_pair(from + 1, range.second));
+        }
+        item.defaultRanges.swap(ranges);
+        item.mappings.erase(std::remove_if(item.mappings.begin(), item.mappings.end(),
+            [from](const std::pair<DWORD, WORD>& mapping) { return mapping.first == from; }),
+            item.mappings.end());
+
+        if (CmapDefaultRangesContain(item.defaultRanges, to)) {
+            item.defaultRanges.push_back(std::make_pair(from, from));
+            std::sort(item.defaultRanges.begin(), item.defaultRanges.end());
+            continue;
+        }
+        for (const auto& mapping : item.mappings) {
+            if (mapping.first != to) continue;
+            item.mappings.push_back(std::make_pair(from, mapping.second));
+            std::sort(item.mappings.begin(), item.mappings.end());
+            break;
+        }
+    }
 }
 
 struct Cmap4Segment {
     WORD start;
     WORD end;
+    WORD delta;
+    bool usesGlyphArray;
     size_t glyphStart;
-    size_t glyphCount;
 };
 
-static bool BuildCmapFormat4(const std::vector<WORD>& glyphs, std::vector<BYTE>& subtable) {
+// Each run of consecutive code points becomes either one glyph-array segment
+// or one delta segment per range, whichever is smaller.
+static bool BuildCmapFormat4(const std::vector<CmapRange>& ranges, std::vector<BYTE>& subtable) {
     subtable.clear();
-    if (glyphs.size() != 65536) return false;
 
     std::vector<Cmap4Segment> segments;
     std::vector<WORD> glyphArray;
-    for (DWORD ch = 0; ch < 0xFFFF;) {
-        if (glyphs[(size_t)ch] == 0) {
-            ++ch;
-            continue;
+    for (size_t i = 0; i < ranges.size() && ranges[i].start <= 0xFFFE;) {
+        size_t runEnd = i + 1;
+        while (runEnd < ranges.size() && ranges[runEnd].start <= 0xFFFE &&
+            ranges[runEnd].start == ranges[runEnd - 1].end + 1) {
+            ++runEnd;
         }
-
-        DWORD start = ch;
-        size_t glyphStart = glyphArray.size();
-        while (ch < 0xFFFF && glyphs[(size_t)ch] != 0) {
-            glyphArray.push_back(glyphs[(size_t)ch]);
-            ++ch;
+        DWORD runStart = ranges[i].start;
+        DWORD runLast = std::min<DWORD>(ranges[runEnd - 1].end, 0xFFFE);
+        size_t arrayCost = 8 + (size_t)(runLast - runStart + 1) * 2;
+        size_t deltaCost = (runEnd - i) * 8;
+
+        if (arrayCost < deltaCost) {
+            Cmap4Segment segment = { (WORD)runStart, (WORD)runLast, 0, true, glyphArray.size() };
+            for (size_t r = i; r < runEnd; ++r) {
+                DWORD last = std::min<DWORD>(ranges[r].end, 0xFFFE);
+                for (DWORD ch = ranges[r].start; ch <= last; ++ch)
+                    glyphArray.push_back((WORD)(ranges[r].startGlyph + (ch - ranges[r].start)));
+            }
+            segments.push_back(segment);
+        } else {
+            for (size_t r = i; r < runEnd; ++r) {
+                DWORD last = std::min<DWORD>(ranges[r].end, 0xFFFE);
+                Cmap4Segment segment = { (WORD)ranges[r].start, (WORD)last,
+                    (WORD)((ranges[r].startGlyph - ranges[r].start) & 0xFFFF), false, 0 };
+                segments.push_back(segment);
+            }
         }
-
-        Cmap4Segment segment = {};
-        segment.start = (WORD)start;
-        segment.end = (WORD)(ch - 1);
-        segment.glyphStart = glyphStart;
-        segment.glyphCount = glyphArray.size() - glyphStart;
-        segments.push_back(segment);
+        i = runEnd;
     }
 
     size_t segCount = segments.size() + 1; // plus 0xFFFF terminator
@@ -678,12 +936,16 @@ static bool BuildCmapFormat4(const std::vector<WORD>& glyphs, std::vector<BYTE>&
     for (const Cmap4Segment& segment : segments) AppendU16BE(subtable, segment.start);
     AppendU16BE(subtable, 0xFFFF);
 
-    for (size_t i = 0; i < segments.size(); ++i) AppendU16BE(subtable, 0);
+    for (const Cmap4Segment& segment : segments) AppendU16BE(subtable, segment.delta);
     AppendU16BE(subtable, 1); // terminator maps 0xFFFF to glyph 0
 
     size_t rangeOffsetBase = subtable.size();
     size_t glyphArrayBase = rangeOffsetBase + segCount * 2;
     for (size_t i = 0; i < segments.size(); ++i) {
+        if (!segments[i].usesGlyphArray) {
+            AppendU16BE(subtable, 0);
+            continue;
+        }
         size_t rangeWordOffset = rangeOffsetBase + i * 2;
         size_t glyphOffset = glyphArrayBase + segments[i].glyphStart * 2;
         size_t delta = glyphOffset - rangeWordOffset;
@@ -696,160 +958,771 @@ static bool BuildCmapFormat4(const std::vector<WORD>& glyphs, std::vector<BYTE>&
     return subtable.size() == length;
 }
 
-struct Cmap12Group {
-    DWORD startChar;
-    DWORD endChar;
-    DWORD startGlyph;
-};
-
-static bool BuildCmapFormat12(const std::vector<WORD>& glyphs, std::vector<BYTE>& subtable) {
+static bool BuildCmapFormat12(const std::vector<CmapRange>& ranges, std::vector<BYTE>& subtable) {
     subtable.clear();
-    if (glyphs.size() != 65536) return false;
-
-    std::vector<Cmap12Group> groups;
-    for (DWORD ch = 0; ch <= 0xFFFF;) {
-        WORD glyph = glyphs[(size_t)ch];
-        if (glyph == 0) {
-            ++ch;
-            continue;
-        }
-
-        DWORD start = ch;
-        DWORD startGlyph = glyph;
-        DWORD end = ch;
-        while (end + 1 <= 0xFFFF) {
-            WORD nextGlyph = glyphs[(size_t)end + 1];
-            if (nextGlyph == 0 || nextGlyph != (WORD)(startGlyph + (end + 1 - start))) break;
-            ++end;
-        }
-
-        Cmap12Group group = {};
-        group.startChar = start;
-        group.endChar = end;
-        group.startGlyph = startGlyph;
-        groups.push_back(group);
-        ch = end + 1;
-    }
-
-    size_t length = 16 + groups.size() * 12;
+    size_t length = 16 + ranges.size() * 12;
     if (length > 0xFFFFFFFFu) return false;
 
+    subtable.reserve(length);
     AppendU16BE(subtable, 12);
     AppendU16BE(subtable, 0); // reserved
     AppendU32BE(subtable, (DWORD)length);
     AppendU32BE(subtable, 0); // language
-    AppendU32BE(subtable, (DWORD)groups.size());
-    for (const Cmap12Group& group : groups) {
-        AppendU32BE(subtable, group.startChar);
-        AppendU32BE(subtable, group.endChar);
-        AppendU32BE(subtable, group.startGlyph);
+    AppendU32BE(subtable, (DWORD)ranges.size());
+    for (const CmapRange& range : ranges) {
+        AppendU32BE(subtable, range.start);
+        AppendU32BE(subtable, range.end);
+        AppendU32BE(subtable, range.startGlyph);
     }
     return true;
 }
 
+static bool BuildCmapFormat14(const std::vector<CmapVariationSelector>& variations, std::vector<BYTE>& subtable) {
+    subtable.clear();
+    std::vector<const CmapVariationSelector*> records;
+    for (const CmapVariationSelector& item : variations) {
+        if (!item.defaultRanges.empty() || !item.mappings.empty()) records.push_back(&item);
+    }
+    if (records.empty()) return false;
+    std::sort(records.begin(), records.end(), [](const CmapVariationSelector* a, const CmapVariationSelector* b) {
+        return a->selector < b->selector;
+    });
+
+    subtable.assign(10 + records.size() * 11, 0);
+    WriteU16BE(subtable.data(), 14);
+    WriteU32BE(subtable.data() + 6, (DWORD)records.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        const CmapVariationSelector& item = *records[i];
+        BYTE* record = subtable.data() + 10 + i * 11;
+        record[0] = (BYTE)((item.selector >> 16) & 0xFF);
+        record[1] = (BYTE)((item.selector >> 8) & 0xFF);
+        record[2] = (BYTE)(item.selector & 0xFF);
+
+        if (!item.defaultRanges.empty()) {
+            std::vector<BYTE> block;
+            DWORD count = 0;
+            AppendU32BE(block, 0);
+            for (const auto& range : item.defaultRanges) {
+                for (DWORD first = range.first; first <= range.second; first += 256) {
+                    AppendU24BE(block, first);
+                    block.push_back((BYTE)std::min<DWORD>(range.second - first, 255));
+                    ++count;
+                    if (range.second - first < 256) break;
+                }
+            }
+            WriteU32BE(block.data(), count);
+            WriteU32BE(subtable.data() + 10 + i * 11 + 3, (DWORD)subtable.size());
+            subtable.insert(subtable.end(), block.begin(), block.end());
+        }
+        if (!item.mappings.empty()) {
+            WriteU32BE(subtable.data() + 10 + i * 11 + 7, (DWORD)subtable.size());
+            AppendU32BE(subtable, (DWORD)item.mappings.size());
+            for (const auto& mapping : item.mappings) {
+                AppendU24BE(subtable, mapping.first);
+                AppendU16BE(subtable, mapping.second);
+            }
+        }
+    }
+    if (subtable.size() > 0xFFFFFFFFu) return false;
+    WriteU32BE(subtable.data() + 2, (DWORD)subtable.size());
+    return true;
+}
+
 struct CmapRecordBuild {
     WORD platformId;
     WORD encodingId;
-    DWORD offset;
+    const std::vector<BYTE>* subtable;
 };
 
-static bool BuildPatchedCmapTable(const std::vector<WORD>& glyphs, std::vector<BYTE>& cmapTable) {
+// Format 4 serves BMP-only consumers such as GDI, format 12 the full range.
+// Records are emitted in the (platform, encoding) order the spec requires.
+static bool BuildUnicodeCmapTable(const UnicodeCmap& source, std::vector<BYTE>& cmapTable) {
     cmapTable.clear();
+    if (source.ranges.empty()) return false;
 
     std::vector<BYTE> format4;
-    bool hasFormat4 = BuildCmapFormat4(glyphs, format4);
-
+    bool hasFormat4 = BuildCmapFormat4(source.ranges, format4);
     std::vector<BYTE> format12;
-    if (!BuildCmapFormat12(glyphs, format12)) return false;
+    if (!BuildCmapFormat12(source.ranges, format12)) return false;
+    std::vector<BYTE> format14;
+    bool hasFormat14 = BuildCmapFormat14(source.variations, format14);
 
     std::vector<CmapRecordBuild> records;
-    if (hasFormat4) {
-        CmapRecordBuild r0 = { 0, 3, 0 };
-        CmapRecordBuild r1 = { 3, 1, 0 };
-        records.push_back(r0);
-        records.push_back(r1);
-    }
-    CmapRecordBuild r2 = { 0, 4, 0 };
-    CmapRecordBuild r3 = { 3, 10, 0 };
-    records.push_back(r2);
-    records.push_back(r3);
-
-    size_t headerSize = 4 + records.size() * 8;
-    if (headerSize > 0xFFFFFFFFu) return false;
-    cmapTable.assign(headerSize, 0);
-    WriteU16BE(cmapTable.data(), 0);
+    if (hasFormat4) records.push_back({ 0, 3, &format4 });
+    records.push_back({ 0, 4, &format12 });
+    if (hasFormat14) records.push_back({ 0, 5, &format14 });
+    if (hasFormat4) records.push_back({ 3, 1, &format4 });
+    records.push_back({ 3, 10, &format12 });
+
+    cmapTable.assign(4 + records.size() * 8, 0);
     WriteU16BE(cmapTable.data() + 2, (WORD)records.size());
 
     DWORD format4Offset = 0;
-    if (hasFormat4) {
-        format4Offset = (DWORD)cmapTable.size();
-        cmapTable.insert(cmapTable.end(), format4.begin(), format4.end());
-    }
-    DWORD format12Offset = (DWORD)cmapTable.size();
-    cmapTable.insert(cmapTable.end(), format12.begin(), format12.end());
-
+    DWORD format12Offset = 0;
     for (size_t i = 0; i < records.size(); ++i) {
-        DWORD offset = (records[i].platformId == 3 && records[i].encodingId == 1) ||
-            (records[i].platformId == 0 && records[i].encodingId == 3)
-            ? format4Offset
-            : format12Offset;
+        const std::vector<BYTE>* subtable = records[i].subtable;
+        DWORD* shared = subtable == &format4 ? &format4Offset : (subtable == &format12 ? &format12Offset : NULL);
+        DWORD offset = shared ? *shared : 0;
+        if (!offset) {
+            offset = (DWORD)cmapTable.size();
+            cmapTable.insert(cmapTable.end(), subtable->begin(), subtable->end());
+            if (shared) *shared = offset;
+        }
         BYTE* record = cmapTable.data() + 4 + i * 8;
         WriteU16BE(record + 0, records[i].platformId);
         WriteU16BE(record + 2, records[i].encodingId);
         WriteU32BE(record + 4, offset);
     }
-
     return cmapTable.size() <= 0xFFFFFFFFu;
 }
 
+static bool ReplaceSfntTableInCollection(std::vector<BYTE>& fontData, size_t fontOffset, DWORD tag,
+    const std::vector<BYTE>& table) {
+    size_t entryOffset = 0;
+    if (!FindSfntTableEntryAt(fontData.data(), fontData.size(), fontOffset, tag, &entryOffset, NULL, NULL))
+        return false;
+
+    // Other faces may share the old table, so it stays in place and only this
+    // face's directory entry is pointed at the appended copy.
+    AlignSfntBuffer(fontData);
+    size_t newOffset = fontData.size();
+    if (newOffset + table.size() > 0xFFFFFFFFu) return false;
+    fontData.insert(fontData.end(), table.begin(), table.end());
+    AlignSfntBuffer(fontData);
+
+    BYTE* entry = fontData.data() + entryOffset;
+    WriteU32BE(entry + 4, CalcSfntChecksum(fontData.data() + newOffset, table.size()));
+    WriteU32BE(entry + 8, (DWORD)newOffset);
+    WriteU32BE(entry + 12, (DWORD)table.size());
+    return UpdateChecksumAdjustmentAt(fontData.data(), fontData.size(), fontOffset);
+}
+
 static bool PatchCmapAliasesAt(std::vector<BYTE>& fontData, size_t fontOffset,
     const FontPatcher::CmapAlias* aliases, size_t aliasCount) {
     if (fontData.empty() || !aliases || aliasCount == 0) return false;
-    if (fontOffset != 0 || ::IsFontCollection(fontData.data(), fontData.size())) return false;
 
-    std::vector<WORD> glyphs;
-    if (!CollectBestUnicodeCmapBmp(fontData.data(), fontData.size(), fontOffset, glyphs)) return false;
+    UnicodeCmap cmap;
+    if (!CollectBestUnicodeCmap(fontData.data(), fontData.size(), fontOffset, cmap)) return false;
 
-    bool changed = false;
+    // Targets resolve against the unpatched cmap, so alias chains do not cascade.
+    std::vector<CmapOverride> overrides;
+    overrides.reserve(aliasCount);
     for (size_t i = 0; i < aliasCount; ++i) {
         DWORD from = aliases[i].fromCodepoint;
         DWORD to = aliases[i].toCodepoint;
-        if (from > 0xFFFE || to > 0xFFFE || from == to) continue;
-        WORD targetGlyph = glyphs[(size_t)to];
+        if (from > kMaxUnicodeCodepoint || to > kMaxUnicodeCodepoint || from == to) continue;
+        WORD targetGlyph = LookupCmapGlyph(cmap.ranges, to);
         if (targetGlyph == 0) continue;
-        if (glyphs[(size_t)from] == targetGlyph) continue;
-        glyphs[(size_t)from] = targetGlyph;
-        changed = true;
+        if (LookupCmapGlyph(cmap.ranges, from) == targetGlyph) continue;
+        CmapOverride item = { from, targetGlyph };
+        overrides.push_back(item);
+        AliasCmapVariations(cmap.variations, from, to);
     }
-    if (!changed) return false;
+    if (overrides.empty()) return false;
+
+    std::stable_sort(overrides.begin(), overrides.end(), [](const CmapOverride& a, const CmapOverride& b) {
+        return a.codepoint < b.codepoint;
+    });
+    overrides.erase(std::unique(overrides.begin(), overrides.end(), [](const CmapOverride& a, const CmapOverride& b) {
+        return a.codepoint == b.codepoint;
+    }), overrides.end());
+    ApplyCmapOverrides(cmap.ranges, overrides);
 
     std::vector<BYTE> newCmap;
-    if (!BuildPatchedCmapTable(glyphs, newCmap) || newCmap.empty()) return false;
+    if (!BuildUnicodeCmapTable(cmap, newCmap)) return false;
+
+    if (::IsFontCollection(fontData.data(), fontData.size()))
+        return ReplaceSfntTableInCollection(fontData, fontOffset, 0x636D6170, newCmap); // 'cmap'
+
+    // The old cmap is dropped rather than left orphaned behind an appended copy.
+    FontPatcher::SfntTableBuilder builder;
+    std::vector<BYTE> rebuilt;
+    if (!builder.Load(fontData.data(), fontData.size(), fontOffset) ||
+        !builder.FindTable(0x636D6170, NULL) || // 'cmap'
+        !builder.ReplaceTable(0x636D6170, std::move(newCmap)) ||
+        !builder.Write(rebuilt))
+        return false;
+    fontData.swap(rebuilt);
+    return true;
+}
 
-    size_t entryOffset = 0;
-    size_t oldCmapOffset = 0;
-    size_t oldCmapLength = 0;
-    if (!FindSfntTableEntryAt(fontData.data(), fontData.size(), fontOffset,
-        0x636D6170, &entryOffset, &oldCmapOffset, &oldCmapLength))
-        return false; // 'cmap'
+// Subsetting keeps glyph ids stable: dropped glyphs become empty outlines, so
+// hmtx, vmtx, maxp, post and the layout tables stay valid without renumbering.
+// Only the outline stores (glyf/loca or CFF CharStrings) and cmap are rebuilt.
+
+// A valid coverage lists each glyph at most once, so ranges are clipped to the
+// font's glyph count and expansion stops after numGlyphs entries; overlapping
+// or inverted ranges in a damaged table cannot grow the list further.
+static void CollectGsubSingleCoverage(const BYTE* coverage, size_t length, size_t numGlyphs,
+    std::vector<std::pair<WORD, WORD>>& entries) {
+    entries.clear();
+    if (length < 4 || numGlyphs == 0) return;
+    WORD format = ReadU16BE(coverage);
+    WORD count = ReadU16BE(coverage + 2);
+    if (format == 1) {
+        if (4 + (size_t)count * 2 > length) return;
+        for (WORD i = 0; i < count && entries.size() < numGlyphs; ++i)
+            entries.push_back(std::make_pair(ReadU16BE(coverage + 4 + (size_t)i * 2), i));
+    } else if (format == 2) {
+        if (4 + (size_t)count * 6 > length) return;
+        for (WORD i = 0; i < count && entries.size() < numGlyphs; ++i) {
+            const BYTE* range = coverage + 4 + (size_t)i * 6;
+            DWORD start = ReadU16BE(range + 0);
+            DWORD end = ReadU16BE(range + 2);
+            WORD startIndex = ReadU16BE(range + 4);
+            if (end < start || start >= numGlyphs) continue;
+            if (end >= numGlyphs) end = (DWORD)numGlyphs - 1;
+            for (DWORD glyph = start; glyph <= end && entries.size() < numGlyphs; ++glyph)
+                entries.push_back(std::make_pair((WORD)glyph, (WORD)(startIndex + (glyph - start))));
+        }
+    }
+}
+
+// Single substitutions (directly or through an extension lookup) carry the
+// vertical and width variants a renderer swaps in for a mapped glyph.
+static bool AddGsubSingleSubstitutes(const BYTE* gsub, size_t length, std::vector<bool>& keep) {
+    if (length < 10) return false;
+    size_t lookupList = ReadU16BE(gsub + 8);
+    if (lookupList == 0 || lookupList + 2 > length) return false;
+    WORD lookupCount = ReadU16BE(gsub + lookupList);
+    if (lookupList + 2 + (size_t)lookupCount * 2 > length) return false;
+
+    bool added = false;
+    std::vector<std::pair<WORD, WORD>> coverage;
+    for (WORD i = 0; i < lookupCount; ++i) {
+        size_t lookup = lookupList + ReadU16BE(gsub + lookupList + 2 + (size_t)i * 2);
+        if (lookup + 6 > length) continue;
+        WORD lookupType = ReadU16BE(gsub + lookup);
+        WORD subtableCount = ReadU16BE(gsub + lookup + 4);
+        if (lookupType != 1 && lookupType != 7) continue;
+        if (lookup + 6 + (size_t)subtableCount * 2 > length) continue;
+
+        for (WORD j = 0; j < subtableCount; ++j) {
+            size_t subtable = lookup + ReadU16BE(gsub + lookup + 6 + (size_t)j * 2);
+            if (subtable + 6 > length) continue;
+            if (lookupType == 7) {
+                if (subtable + 8 > length || ReadU16BE(gsub + subtable + 2) != 1) continue;
+                subtable += ReadU32BE(gsub + subtable + 4);
+                if (subtable + 6 > length) continue;
+            }
+
+            WORD format = ReadU16BE(gsub + subtable);
+            size_t coverageOffset = subtable + ReadU16BE(gsub + subtable + 2);
+            if (coverageOffset >= length || (format != 1 && format != 2)) continue;
+            CollectGsubSingleCoverage(gsub + coverageOffset, length - coverageOffset, keep.size(), coverage);
+
+            // Format 1 stores deltaGlyphID here, format 2 the substitute count.
+            WORD deltaOrCount = ReadU16BE(gsub + subtable + 4);
+            for (const auto& entry : coverage) {
+                if (entry.first >= keep.size() || !keep[entry.first]) continue;
+                WORD substitute = 0;
+                if (format == 1) {
+                    substitute = (WORD)(entry.first + deltaOrCount);
+                } else {
+                    size_t slot = subtable + 6 + (size_t)entry.second * 2;
+                    if (entry.second >= deltaOrCount || slot + 2 > length) continue;
+                    substitute = ReadU16BE(gsub + slot);
+                }
+                if (substitute < keep.size() && !keep[substitute]) {
+                    keep[substitute] = true;
+                    added = true;
+                }
+            }
+        }
+    }
+    return added;
+}
+
+static bool ReadGlyfLocation(const BYTE* loca, size_t locaLength, bool longLoca, size_t glyph,
+    size_t* offset, size_t* length) {
+    size_t entrySize = longLoca ? 4 : 2;
+    if ((glyph + 2) * entrySize > locaLength) return false;
+    size_t start = longLoca ? ReadU32BE(loca + glyph * 4) : (size_t)ReadU16BE(loca + glyph * 2) * 2;
+    size_t end = longLoca ? ReadU32BE(loca + glyph * 4 + 4) : (size_t)ReadU16BE(loca + glyph * 2 + 2) * 2;
+    if (end < start) return false;
+    *offset = start;
+    *length = end - start;
+    return true;
+}
+
+static void AddGlyfComponents(const BYTE* glyf, size_t glyfLength, const BYTE* loca, size_t locaLength,
+    bool longLoca, std::vector<bool>& keep) {
+    std::vector<WORD> pending;
+    for (size_t glyph = 0; glyph < keep.size(); ++glyph) {
+        if (keep[glyph]) pending.push_back((WORD)glyph);
+    }
+
+    while (!pending.empty()) {
+        WORD glyph = pending.back();
+        pending.pop_back();
+        size_t offset = 0;
+        size_t length = 0;
+        if (!ReadGlyfLocation(loca, locaLength, longLoca, glyph, &offset, &length)) continue;
+        if (length < 10 || offset > glyfLength || length > glyfLength - offset) continue;
+
+        const BYTE* data = glyf + offset;
+        if ((SHORT)ReadU16BE(data) >= 0) continue;
+
+        size_t pos = 10;
+        for (;;) {
+            if (pos + 4 > length) break;
+            WORD flags = ReadU16BE(data + pos);
+            WORD component = ReadU16BE(data + pos + 2);
+            pos += 4 + ((flags & 0x0001) ? 4 : 2);     // ARG_1_AND_2_ARE_WORDS
+            if (flags & 0x0008) pos += 2;               // WE_HAVE_A_SCALE
+            else if (flags & 0x0040) pos += 4;          // WE_HAVE_AN_X_AND_Y_SCALE
+            else if (flags & 0x0080) pos += 8;          // WE_HAVE_A_TWO_BY_TWO
+            if (component < keep.size() && !keep[component]) {
+                keep[component] = true;
+                pending.push_back(component);
+            }
+            if (!(flags & 0x0020)) break;               // MORE_COMPONENTS
+        }
+    }
+}
+
+static bool BuildSubsetGlyf(const BYTE* glyf, size_t glyfLength, const BYTE* loca, size_t locaLength,
+    bool longLoca, const std::vector<bool>& keep, std::vector<BYTE>& newGlyf, std::vector<BYTE>& newLoca,
+    bool* newLongLoca) {
+    newGlyf.clear();
+    newLoca.clear();
+    std::vector<DWORD> offsets(keep.size() + 1, 0);
+    for (size_t glyph = 0; glyph < keep.size(); ++glyph) {
+        offsets[glyph] = (DWORD)newGlyf.size();
+        if (!keep[glyph]) continue;
+
+        size_t offset = 0;
+        size_t length = 0;
+        if (!ReadGlyfLocation(loca, locaLength, longLoca, glyph, &offset, &length)) return false;
+        if (offset > glyfLength || length > glyfLength - offset) return false;
+        newGlyf.insert(newGlyf.end(), glyf + offset, glyf + offset + length);
+        AlignSfntBuffer(newGlyf);
+        if (newGlyf.size() > 0xFFFFFFFFu) return false;
+    }
+    offsets[keep.size()] = (DWORD)newGlyf.size();
+
+    *newLongLoca = newGlyf.size() > 0x1FFFE;
+    newLoca.reserve(offsets.size() * (*newLongLoca ? 4 : 2));
+    for (DWORD offset : offsets) {
+        if (*newLongLoca) AppendU32BE(newLoca, offset);
+        else AppendU16BE(newLoca, (WORD)(offset / 2));
+    }
+    return true;
+}
+
+struct CffIndexInfo {
+    WORD count;
+    BYTE offSize;
+    size_t offsetArray;     // first offset entry
+    size_t dataBase;        // offsets are relative to the byte before the data
+    size_t end;
+};
 
-    size_t alignedOffset = (fontData.size() + 3) & ~(size_t)3;
-    if (alignedOffset > fontData.size())
-        fontData.insert(fontData.end(), alignedOffset - fontData.size(), 0);
+static DWORD ReadCffOffset(const BYTE* p, BYTE offSize) {
+    DWORD value = 0;
+    for (BYTE i = 0; i < offSize; ++i) value = (value << 8) | p[i];
+    return value;
+}
+
+static bool ParseCffIndex(const BYTE* cff, size_t length, size_t pos, CffIndexInfo& index) {
+    if (pos > length || length - pos < 2) return false;
+    index.count = ReadU16BE(cff + pos);
+    if (index.count == 0) {
+        index.offSize = 0;
+        index.offsetArray = index.dataBase = pos + 2;
+        index.end = pos + 2;
+        return true;
+    }
 
-    size_t newCmapOffset = fontData.size();
-    fontData.insert(fontData.end(), newCmap.begin(), newCmap.end());
-    while ((fontData.size() & 3) != 0)
-        fontData.push_back(0);
+    if (length - pos < 3) return false;
+    index.offSize = cff[pos + 2];
+    if (index.offSize < 1 || index.offSize > 4) return false;
+    index.offsetArray = pos + 3;
+    size_t arrayLength = ((size_t)index.count + 1) * index.offSize;
+    if (arrayLength > length - index.offsetArray) return false;
+    index.dataBase = index.offsetArray + arrayLength - 1;
+
+    DWORD last = ReadCffOffset(cff + index.offsetArray + (size_t)index.count * index.offSize, index.offSize);
+    if (last < 1 || last > length - index.dataBase) return false;
+    index.end = index.dataBase + last;
+    return true;
+}
 
-    BYTE* data = fontData.data();
-    WriteU32BE(data + entryOffset + 4, CalcSfntChecksum(fontData.data() + newCmapOffset, newCmap.size()));
-    WriteU32BE(data + entryOffset + 8, (DWORD)newCmapOffset);
-    WriteU32BE(data + entryOffset + 12, (DWORD)newCmap.size());
-    UpdateChecksumAdjustment(fontData);
+static bool CffIndexItem(const BYTE* cff, const CffIndexInfo& index, WORD item, size_t* start, size_t* end) {
+    if (item >= index.count) return false;
+    DWORD first = ReadCffOffset(cff + index.offsetArray + (size_t)item * index.offSize, index.offSize);
+    DWORD next = ReadCffOffset(cff + index.offsetArray + ((size_t)item + 1) * index.offSize, index.offSize);
+    if (first < 1 || next < first || index.dataBase + next > index.end) return false;
+    *start = index.dataBase + first;
+    *end = index.dataBase + next;
     return true;
 }
 
+struct CffDictOperand {
+    size_t pos;
+    size_t width;
+    long value;
+};
+
+// Walks one DICT and hands every operator with its integer operands to visit.
+// Real operands are skipped and recorded with width 0.
+template <typename Visit>
+static bool WalkCffDict(const BYTE* dict, size_t length, Visit visit) {
+    std::vector<CffDictOperand> operands;
+    size_t pos = 0;
+    while (pos < length) {
+        BYTE b0 = dict[pos];
+        CffDictOperand operand = { pos, 0, 0 };
+        if (b0 <= 21) {
+            WORD op = b0;
+            if (b0 == 12) {
+                if (pos + 1 >= length) return false;
+                op = (WORD)(0x0C00 | dict[pos + 1]);
+                ++pos;
+            }
+            ++pos;
+            if (!visit(op, operands)) return false;
+            operands.clear();
+            continue;
+        }
+        if (b0 == 28) {
+            if (pos + 3 > length) return false;
+            operand.width = 3;
+            operand.value = (SHORT)ReadU16BE(dict + pos + 1);
+        } else if (b0 == 29) {
+            if (pos + 5 > length) return false;
+            operand.width = 5;
+            operand.value = (long)(int)ReadU32BE(dict + pos + 1);
+        } else if (b0 == 30) {
+            size_t end = pos + 1;
+            while (end < length && (dict[end] & 0x0F) != 0x0F && (dict[end] & 0xF0) != 0xF0) ++end;
+            if (end >= length) return false;
+            pos = end + 1;
+            operands.push_back(operand);
+            continue;
+        } else if (b0 >= 32 && b0 <= 246) {
+            operand.width = 1;
+            operand.value = (long)b0 - 139;
+        } else if (b0 >= 247 && b0 <= 250) {
+            if (pos + 2 > length) return false;
+            operand.width = 2;
+            operand.value = ((long)b0 - 247) * 256 + dict[pos + 1] + 108;
+        } else if (b0 >= 251 && b0 <= 254) {
+            if (pos + 2 > length) return false;
+            operand.width = 2;
+            operand.value = -((long)b0 - 251) * 256 - dict[pos + 1] - 108;
+        } else {
+            return false;
+        }
+        pos += operand.width;
+        operands.push_back(operand);
+    }
+    return true;
+}
+
+// Re-encodes an integer operand in the width it already occupies, so the DICT
+// and the INDEX holding it keep their size.
+static bool RewriteCffOperand(BYTE* p, size_t width, long value) {
+    switch (width) {
+    case 5:
+        p[0] = 29;
+        WriteU32BE(p + 1, (DWORD)value);
+        return true;
+    case 3:
+        if (value < -32768 || value > 32767) return false;
+        p[0] = 28;
+        WriteU16BE(p + 1, (WORD)(SHORT)value);
+        return true;
+    case 2:
+        if (value < 108 || value > 1131) return false;
+        p[0] = (BYTE)(247 + ((value - 108) >> 8));
+        p[1] = (BYTE)((value - 108) & 0xFF);
+        return true;
+    case 1:
+        if (value < -107 || value > 107) return false;
+        p[0] = (BYTE)(value + 139);
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool IsCffOffsetOperator(WORD op) {
+    return op == 15 || op == 16 || op == 17 || op == 18 || op == 0x0C24 || op == 0x0C25;
+}
+
+// Moves every offset operand that points at or past `from` back by `delta`.
+static bool ShiftCffDictOffsets(BYTE* dict, size_t length, size_t from, size_t delta) {
+    return WalkCffDict(dict, length, [&](WORD op, const std::vector<CffDictOperand>& operands) {
+        if (!IsCffOffsetOperator(op) || operands.empty()) return true;
+        const CffDictOperand& offset = operands.back();
+        if (offset.width == 0 || offset.value < 0 || (size_t)offset.value < from) return true;
+        return RewriteCffOperand(dict + offset.pos, offset.width, offset.value - (long)delta);
+    });
+}
+
+struct CffLayout {
+    size_t topDictStart;
+    size_t topDictEnd;
+    size_t charStrings;
+    size_t fdArray;
+    std::vector<size_t> offsets;                        // every Top DICT offset operand
+    std::vector<std::pair<size_t, size_t>> privates;   // offset, size
+};
+
+static bool ReadCffPrivate(const std::vector<CffDictOperand>& operands, std::vector<std::pair<size_t, size_t>>& privates) {
+    if (operands.size() < 2 || operands[0].width == 0 || operands[1].width == 0) return false;
+    if (operands[0].value < 0 || operands[1].value < 0) return false;
+    privates.push_back(std::make_pair((size_t)operands[1].value, (size_t)operands[0].value));
+    return true;
+}
+
+static bool ParseCffLayout(const BYTE* cff, size_t length, CffLayout& layout) {
+    layout = CffLayout();
+    if (length < 4 || cff[0] != 1) return false;
+
+    CffIndexInfo names = {};
+    CffIndexInfo topDicts = {};
+    if (!ParseCffIndex(cff, length, cff[2], names) ||
+        !ParseCffIndex(cff, length, names.end, topDicts) ||
+        topDicts.count != 1 ||
+        !CffIndexItem(cff, topDicts, 0, &layout.topDictStart, &layout.topDictEnd))
+        return false;
+
+    bool ok = WalkCffDict(cff + layout.topDictStart, layout.topDictEnd - layout.topDictStart,
+        [&](WORD op, const std::vector<CffDictOperand>& operands) {
+            if (op == 0x0C06 && !operands.empty() && operands[0].value != 2) return false; // CharstringType
+            if (op == 17 && !operands.empty()) layout.charStrings = (size_t)operands.back().value;
+            if (op == 0x0C24 && !operands.empty()) layout.fdArray = (size_t)operands.back().value;
+            if (IsCffOffsetOperator(op) && !operands.empty() && operands.back().value > 1)
+                layout.offsets.push_back((size_t)operands.back().value);
+            if (op == 18) return ReadCffPrivate(operands, layout.privates);
+            return true;
+        });
+    if (!ok || layout.charStrings == 0) return false;
+
+    if (layout.fdArray) {
+        CffIndexInfo fonts = {};
+        if (!ParseCffIndex(cff, length, layout.fdArray, fonts)) return false;
+        for (WORD i = 0; i < fonts.count; ++i) {
+            size_t start = 0;
+            size_t end = 0;
+            if (!CffIndexItem(cff, fonts, i, &start, &end)) return false;
+            ok = WalkCffDict(cff + start, end - start, [&](WORD op, const std::vector<CffDictOperand>& operands) {
+                return op != 18 || ReadCffPrivate(operands, layout.privates);
+            });
+            if (!ok) return false;
+        }
+    }
+    return true;
+}
+
+// Replaces dropped CharStrings with a bare endchar and closes the gap, then
+// shifts every structure that followed. Charsets, FDSelect and the Private
+// DICTs are copied untouched because glyph ids do not change.
+static bool BuildSubsetCff(const BYTE* cff, size_t length, const std::vector<bool>& keep, std::vector<BYTE>& newCff) {
+    newCff.clear();
+    CffLayout layout;
+    CffIndexInfo charStrings = {};
+    if (!ParseCffLayout(cff, length, layout) ||
+        !ParseCffIndex(cff, length, layout.charStrings, charStrings) ||
+        charStrings.count != keep.size() ||
+        layout.topDictEnd > layout.charStrings)
+        return false;
+
+    size_t csStart = layout.charStrings;
+    size_t csEnd = charStrings.end;
+    for (size_t offset : layout.offsets) {
+        if (offset > csStart && offset < csEnd) return false;
+    }
+    for (const auto& priv : layout.privates) {
+        if (priv.first > length || priv.second > length - priv.first) return false;
+        if (priv.first < csEnd && priv.first + priv.second > csStart) return false;
+        if (priv.first >= csEnd) continue;
+
+        // Local Subrs are relative to their Private DICT and must not straddle the gap.
+        bool ok = WalkCffDict(cff + priv.first, priv.second, [&](WORD op, const std::vector<CffDictOperand>& operands) {
+            if (op != 19 || operands.empty()) return true;
+            return priv.first + (size_t)operands.back().value < csStart;
+        });
+        if (!ok) return false;
+    }
+
+    std::vector<BYTE> data;
+    std::vector<DWORD> offsets;
+    offsets.reserve((size_t)charStrings.count + 1);
+    for (WORD glyph = 0; glyph < charStrings.count; ++glyph) {
+        offsets.push_back((DWORD)data.size() + 1);
+        size_t start = 0;
+        size_t end = 0;
+        if (keep[glyph] && CffIndexItem(cff, charStrings, glyph, &start, &end)) {
+            data.insert(data.end(), cff + start, cff + end);
+        } else {
+            data.push_back(14); // endchar
+        }
+    }
+    offsets.push_back((DWORD)data.size() + 1);
+
+    BYTE offSize = data.size() + 1 <= 0xFF ? 1 : (data.size() + 1 <= 0xFFFF ? 2 : (data.size() + 1 <= 0xFFFFFF ? 3 : 4));
+    size_t newLength = 3 + offsets.size() * offSize + data.size();
+    if (newLength >= csEnd - csStart) {
+        // Nothing to reclaim; the original CharStrings already cover `keep`.
+        newCff.assign(cff, cff + length);
+        return true;
+    }
+
+    newCff.reserve(length - (csEnd - csStart) + newLength);
+    newCff.insert(newCff.end(), cff, cff + csStart);
+    AppendU16BE(newCff, charStrings.count);
+    newCff.push_back(offSize);
+    for (DWORD offset : offsets) {
+        for (int shift = (offSize - 1) * 8; shift >= 0; shift -= 8)
+            newCff.push_back((BYTE)((offset >> shift) & 0xFF));
+    }
+    newCff.insert(newCff.end(), data.begin(), data.end());
+    newCff.insert(newCff.end(), cff + csEnd, cff + length);
+
+    size_t delta = (csEnd - csStart) - newLength;
+    if (!ShiftCffDictOffsets(newCff.data() + layout.topDictStart, layout.topDictEnd - layout.topDictStart,
+        csEnd, delta))
+        return false;
+
+    if (layout.fdArray) {
+        size_t fdArray = layout.fdArray >= csEnd ? layout.fdArray - delta : layout.fdArray;
+        CffIndexInfo fonts = {};
+        if (!ParseCffIndex(newCff.data(), newCff.size(), fdArray, fonts)) return false;
+        for (WORD i = 0; i < fonts.count; ++i) {
+            size_t start = 0;
+            size_t end = 0;
+            if (!CffIndexItem(newCff.data(), fonts, i, &start, &end) ||
+                !ShiftCffDictOffsets(newCff.data() + start, end - start, csEnd, delta))
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool SubsetSfnt(const BYTE* data, size_t size, const DWORD* codepoints, size_t codepointCount,
+    std::vector<BYTE>& outFontData) {
+    FontPatcher::SfntTableBuilder builder;
+    if (!builder.Load(data, size, 0)) return false;
+    if (builder.FindTable(0x66766172, NULL) || builder.FindTable(0x43464632, NULL)) return false; // 'fvar', 'CFF2'
+
+    size_t maxpLength = 0;
+    const BYTE* maxp = builder.FindTable(0x6D617870, &maxpLength); // 'maxp'
+    if (!maxp || maxpLength < 6) return false;
+    WORD numGlyphs = ReadU16BE(maxp + 4);
+    if (numGlyphs == 0) return false;
+
+    UnicodeCmap source;
+    if (!CollectBestUnicodeCmap(data, size, 0, source)) return false;
+
+    std::vector<DWORD> requested(codepoints, codepoints + codepointCount);
+    std::sort(requested.begin(), requested.end());
+    requested.erase(std::unique(requested.begin(), requested.end()), requested.end());
+
+    std::vector<bool> keep(numGlyphs, false);
+    keep[0] = true;
+    UnicodeCmap subset;
+    for (DWORD codepoint : requested) {
+        if (codepoint > kMaxUnicodeCodepoint) break;
+        WORD glyph = LookupCmapGlyph(source.ranges, codepoint);
+        if (glyph == 0 || glyph >= numGlyphs) continue;
+        AppendCmapRange(subset.ranges, codepoint, codepoint, glyph);
+        keep[glyph] = true;
+    }
+    if (subset.ranges.empty()) return false;
+    DWORD firstChar = std::min<DWORD>(subset.ranges.front().start, 0xFFFF);
+    DWORD lastChar = std::min<DWORD>(subset.ranges.back().end, 0xFFFF);
+
+    // Variation sequences survive for kept base characters, with their glyphs.
+    for (const CmapVariationSelector& item : source.variations) {
+        CmapVariationSelector kept;
+        kept.selector = item.selector;
+        for (const auto& range : item.defaultRanges) {
+            for (DWORD codepoint = range.first; codepoint <= range.second; ++codepoint) {
+                if (std::binary_search(requested.begin(), requested.end(), codepoint))
+                    kept.defaultRanges.push_back(std::make_pair(codepoint, codepoint));
+            }
+        }
+        for (const auto& mapping : item.mappings) {
+            if (mapping.second >= numGlyphs ||
+                !std::binary_search(requested.begin(), requested.end(), mapping.first))
+                continue;
+            kept.mappings.push_back(mapping);
+            keep[mapping.second] = true;
+        }
+        subset.variations.push_back(std::move(kept));
+    }
+
+    size_t gsubLength = 0;
+    const BYTE* gsub = builder.FindTable(0x47535542, &gsubLength); // 'GSUB'
+    for (int pass = 0; gsub && pass < 4; ++pass) {
+        if (!AddGsubSingleSubstitutes(gsub, gsubLength, keep)) break;
+    }
+
+    size_t glyfLength = 0;
+    size_t locaLength = 0;
+    size_t cffLength = 0;
+    size_t headLength = 0;
+    const BYTE* glyf = builder.FindTable(0x676C7966, &glyfLength); // 'glyf'
+    const BYTE* loca = builder.FindTable(0x6C6F6361, &locaLength); // 'loca'
+    const BYTE* cff = builder.FindTable(0x43464620, &cffLength);   // 'CFF '
+    const BYTE* head = builder.FindTable(0x68656164, &headLength); // 'head'
+    if (!head || headLength < 54) return false;
+
+    if (glyf && loca) {
+        bool longLoca = ReadU16BE(head + 50) != 0;
+        AddGlyfComponents(glyf, glyfLength, loca, locaLength, longLoca, keep);
+
+        std::vector<BYTE> newGlyf;
+        std::vector<BYTE> newLoca;
+        bool newLongLoca = longLoca;
+        if (!BuildSubsetGlyf(glyf, glyfLength, loca, locaLength, longLoca, keep, newGlyf, newLoca, &newLongLoca))
+            return false;
+
+        std::vector<BYTE> newHead(head, head + headLength);
+        WriteU16BE(newHead.data() + 50, newLongLoca ? 1 : 0); // indexToLocFormat
+        builder.ReplaceTable(0x676C7966, std::move(newGlyf));
+        builder.ReplaceTable(0x6C6F6361, std::move(newLoca));
+        builder.ReplaceTable(0x68656164, std::move(newHead));
+    } else if (cff) {
+        // A CFF that cannot be rebuilt fails the subset rather than shipping
+        // the full outlines behind a reduced cmap.
+        std::vector<BYTE> newCff;
+        if (!BuildSubsetCff(cff, cffLength, keep, newCff) ||
+            !builder.ReplaceTable(0x43464620, std::move(newCff)))
+            return false;
+    } else {
+        return false;
+    }
+
+    std::vector<BYTE> newCmap;
+    if (!BuildUnicodeCmapTable(subset, newCmap) || !builder.ReplaceTable(0x636D6170, std::move(newCmap)))
+        return false; // 'cmap'
+
+    size_t os2Length = 0;
+    const BYTE* os2 = builder.FindTable(0x4F532F32, &os2Length); // 'OS/2'
+    if (os2 && os2Length >= 68) {
+        std::vector<BYTE> newOs2(os2, os2 + os2Length);
+        WriteU16BE(newOs2.data() + 64, (WORD)firstChar);   // usFirstCharIndex
+        WriteU16BE(newOs2.data() + 66, (WORD)lastChar);    // usLastCharIndex
+        builder.ReplaceTable(0x4F532F32, std::move(newOs2));
+    }
+
+    // Glyph names are not needed by any consumer here; version 3 drops them.
+    size_t postLength = 0;
+    const BYTE* post = builder.FindTable(0x706F7374, &postLength); // 'post'
+    if (post && postLength > 32 && ReadU32BE(post) != 0x00030000) {
+        std::vector<BYTE> newPost(post, post + 32);
+        WriteU32BE(newPost.data(), 0x00030000);
+        builder.ReplaceTable(0x706F7374, std::move(newPost));
+    }
+
+    builder.RemoveTable(0x44534947); // 'DSIG' no longer matches
+    return builder.Write(outFontData);
+}
+
 namespace FontPatcher {
     bool IsFontFile(const void* data, size_t size) {
         if (!data || size < 12) return false;
@@ -1057,36 +1930,33 @@ namespace FontPatcher {
             ascentPermille, descentPermille, lineGapPermille);
     }
 
-    static bool PatchNameTableFamilyAt(std::vector<BYTE>& fontData, size_t fontOffset,
-        const wchar_t* familyName, bool allowAppend) {
-        if (fontData.empty() || !familyName || !familyName[0]) return false;
-        if (fontOffset > fontData.size() || fontData.size() - fontOffset < 12) return false;
-        if (!IsSfntVersion(ReadU32BE(fontData.data() + fontOffset))) return false;
+    struct NameRecordData {
+        WORD platformId;
+        WORD encodingId;
+        WORD languageId;
+        WORD nameId;
+        std::vector<BYTE> bytes;
+    };
+
+    // Decodes the name table at fontOffset with the family records replaced.
+    // canPatchInPlace reports whether every replacement fits its old slot.
+    static bool CollectFamilyNameRecords(const BYTE* data, size_t size, size_t fontOffset,
+        const wchar_t* familyName, std::vector<NameRecordData>& records, bool* canPatchInPlace) {
+        records.clear();
+        *canPatchInPlace = true;
 
-        size_t entryOffset = 0;
         size_t nameOffset = 0;
         size_t nameLength = 0;
-        if (!FindSfntTableEntryAt(fontData.data(), fontData.size(), fontOffset,
-            0x6E616D65, &entryOffset, &nameOffset, &nameLength))
+        if (!FindSfntTableAt(data, size, fontOffset, 0x6E616D65, &nameOffset, &nameLength))
             return false; // 'name'
         if (nameLength < 6) return false;
 
-        const BYTE* oldName = fontData.data() + nameOffset;
+        const BYTE* oldName = data + nameOffset;
         WORD count = ReadU16BE(oldName + 2);
         WORD stringOffset = ReadU16BE(oldName + 4);
         if (6 + (size_t)count * 12 > nameLength || stringOffset > nameLength) return false;
 
-        struct NameRecordData {
-            WORD platformId;
-            WORD encodingId;
-            WORD languageId;
-            WORD nameId;
-            std::vector<BYTE> bytes;
-        };
-
-        std::vector<NameRecordData> records;
         records.reserve(count);
-        bool canPatchInPlace = true;
         for (WORD i = 0; i < count; ++i) {
             const BYTE* record = oldName + 6 + (size_t)i * 12;
             NameRecordData item = {};
@@ -1102,7 +1972,7 @@ namespace FontPatcher {
                 size_t sourceOffset = (size_t)stringOffset + oldOffset;
                 if (sourceOffset > nameLength || oldLength > nameLength - sourceOffset ||
                     item.bytes.size() > oldLength) {
-                    canPatchInPlace = false;
+                    *canPatchInPlace = false;
                 }
             } else {
                 size_t sourceOffset = (size_t)stringOffset + oldOffset;
@@ -1112,13 +1982,55 @@ namespace FontPatcher {
                 }
             }
             if (item.bytes.size() > 65535) return false;
-            records.push_back(item);
+            records.push_back(std::move(item));
+        }
+        return true;
+    }
+
+    static bool BuildFamilyNameTable(const std::vector<NameRecordData>& records, std::vector<BYTE>& newName) {
+        newName.clear();
+        size_t storageOffset = 6 + (size_t)records.size() * 12;
+        if (storageOffset > 65535) return false;
+        AppendU16BE(newName, 0); // format 0, enough for standard GDI names
+        AppendU16BE(newName, (WORD)records.size());
+        AppendU16BE(newName, (WORD)storageOffset);
+
+        std::vector<BYTE> storage;
+        for (const auto& item : records) {
+            if (storage.size() > 65535) return false;
+            AppendU16BE(newName, item.platformId);
+            AppendU16BE(newName, item.encodingId);
+            AppendU16BE(newName, item.languageId);
+            AppendU16BE(newName, item.nameId);
+            AppendU16BE(newName, (WORD)item.bytes.size());
+            AppendU16BE(newName, (WORD)storage.size());
+            storage.insert(storage.end(), item.bytes.begin(), item.bytes.end());
         }
 
+        newName.insert(newName.end(), storage.begin(), storage.end());
+        return !newName.empty();
+    }
+
+    static bool PatchNameTableFamilyAt(std::vector<BYTE>& fontData, size_t fontOffset,
+        const wchar_t* familyName, bool allowRebuild) {
+        if (fontData.empty() || !familyName || !familyName[0]) return false;
+        if (fontOffset > fontData.size() || fontData.size() - fontOffset < 12) return false;
+        if (!IsSfntVersion(ReadU32BE(fontData.data() + fontOffset))) return false;
+
+        std::vector<NameRecordData> records;
+        bool canPatchInPlace = true;
+        if (!CollectFamilyNameRecords(fontData.data(), fontData.size(), fontOffset, familyName,
+            records, &canPatchInPlace))
+            return false;
+
         if (canPatchInPlace) {
+            size_t nameOffset = 0;
+            size_t nameLength = 0;
+            FindSfntTableAt(fontData.data(), fontData.size(), fontOffset, 0x6E616D65, &nameOffset, &nameLength);
             BYTE* writableName = fontData.data() + nameOffset;
-            for (WORD i = 0; i < count; ++i) {
-                BYTE* record = writableName + 6 + (size_t)i * 12;
+            WORD stringOffset = ReadU16BE(writableName + 4);
+            for (size_t i = 0; i < records.size(); ++i) {
+                BYTE* record = writableName + 6 + i * 12;
                 WORD nameId = ReadU16BE(record + 6);
                 if (!IsReplaceNameId(nameId)) continue;
 
@@ -1134,45 +2046,19 @@ namespace FontPatcher {
             return true;
         }
 
-        if (!allowAppend)
+        if (!allowRebuild)
             return false;
 
         std::vector<BYTE> newName;
-        size_t storageOffset = 6 + (size_t)records.size() * 12;
-        if (storageOffset > 65535) return false;
-        AppendU16BE(newName, 0); // format 0, enough for standard GDI names
-        AppendU16BE(newName, (WORD)records.size());
-        AppendU16BE(newName, (WORD)storageOffset);
+        if (!BuildFamilyNameTable(records, newName)) return false;
 
-        std::vector<BYTE> storage;
-        for (const auto& item : records) {
-            if (storage.size() > 65535) return false;
-            AppendU16BE(newName, item.platformId);
-            AppendU16BE(newName, item.encodingId);
-            AppendU16BE(newName, item.languageId);
-            AppendU16BE(newName, item.nameId);
-            AppendU16BE(newName, (WORD)item.bytes.size());
-            AppendU16BE(newName, (WORD)storage.size());
-            storage.insert(storage.end(), item.bytes.begin(), item.bytes.end());
-        }
-
-        newName.insert(newName.end(), storage.begin(), storage.end());
-        if (newName.empty()) return false;
-
-        size_t alignedOffset = (fontData.size() + 3) & ~(size_t)3;
-        if (alignedOffset > fontData.size())
-            fontData.insert(fontData.end(), alignedOffset - fontData.size(), 0);
-
-        size_t newNameOffset = fontData.size();
-        fontData.insert(fontData.end(), newName.begin(), newName.end());
-        while ((fontData.size() & 3) != 0)
-            fontData.push_back(0);
-
-        BYTE* data = fontData.data();
-        WriteU32BE(data + entryOffset + 4, CalcSfntChecksum(fontData.data() + newNameOffset, newName.size()));
-        WriteU32BE(data + entryOffset + 8, (DWORD)newNameOffset);
-        WriteU32BE(data + entryOffset + 12, (DWORD)newName.size());
-        UpdateChecksumAdjustment(fontData);
+        SfntTableBuilder builder;
+        std::vector<BYTE> rebuilt;
+        if (!builder.Load(fontData.data(), fontData.size(), fontOffset) ||
+            !builder.ReplaceTable(0x6E616D65, std::move(newName)) ||
+            !builder.Write(rebuilt))
+            return false;
+        fontData.swap(rebuilt);
         return true;
     }
 
@@ -1191,12 +2077,55 @@ namespace FontPatcher {
         return changed;
     }
 
+    bool CloneWithNameTableFamily(const std::vector<BYTE>& fontData, const wchar_t* familyName,
+        std::vector<BYTE>& outFontData) {
+        outFontData.clear();
+        if (fontData.empty() || !familyName || !familyName[0]) return false;
+        if (IsFontCollection(fontData.data(), fontData.size())) {
+            outFontData = fontData;
+            if (PatchNameTableFamily(outFontData, familyName)) return true;
+            outFontData.clear();
+            return false;
+        }
+
+        std::vector<NameRecordData> records;
+        bool canPatchInPlace = true;
+        std::vector<BYTE> newName;
+        SfntTableBuilder builder;
+        if (!CollectFamilyNameRecords(fontData.data(), fontData.size(), 0, familyName,
+                records, &canPatchInPlace) ||
+            !BuildFamilyNameTable(records, newName) ||
+            !builder.Load(fontData.data(), fontData.size(), 0) ||
+            !builder.ReplaceTable(0x6E616D65, std::move(newName)) || // 'name'
+            !builder.Write(outFontData)) {
+            outFontData.clear();
+            return false;
+        }
+        return true;
+    }
+
     bool PatchCmapAliases(std::vector<BYTE>& fontData, const CmapAlias* aliases, size_t aliasCount) {
+        return PatchCmapAliases(fontData, 0, aliases, aliasCount);
+    }
+
+    bool PatchCmapAliases(std::vector<BYTE>& fontData, DWORD faceIndex,
+        const CmapAlias* aliases, size_t aliasCount) {
         if (fontData.empty() || !aliases || aliasCount == 0) return false;
-        if (IsFontCollection(fontData.data(), fontData.size())) return false;
 
         std::vector<size_t> offsets;
-        if (!GetFontOffsets(fontData.data(), fontData.size(), offsets) || offsets.empty()) return false;
-        return PatchCmapAliasesAt(fontData, offsets[0], aliases, aliasCount);
+        if (!GetFontOffsets(fontData.data(), fontData.size(), offsets) || faceIndex >= offsets.size())
+            return false;
+        return PatchCmapAliasesAt(fontData, offsets[faceIndex], aliases, aliasCount);
+    }
+
+    bool SubsetFont(const std::vector<BYTE>& fontData, const DWORD* codepoints, size_t codepointCount,
+        std::vector<BYTE>& outFontData) {
+        outFontData.clear();
+        if (fontData.empty() || !codepoints || codepointCount == 0) return false;
+        if (!SubsetSfnt(fontData.data(), fontData.size(), codepoints, codepointCount, outFontData)) {
+            outFontData.clear();
+            return false;
+        }
+        return true;
     }
 }
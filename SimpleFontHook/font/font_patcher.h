@@ -8,6 +8,34 @@ namespace FontPatcher {
         DWORD toCodepoint;
     };
 
+    // Table-directory editor for one sfnt face. Replacement tables are recorded
+    // by tag and Write streams the new font in a single pass. Unchanged tables
+    // reuse their directory checksums, so only replaced tables and head are
+    // summed. The source bytes must outlive the builder.
+    class SfntTableBuilder {
+    public:
+        bool Load(const BYTE* data, size_t size, size_t fontOffset, bool recomputeChecksums = false);
+        const BYTE* FindTable(DWORD tag, size_t* length) const;
+        // Replaces the table with the same tag, or inserts it in tag order.
+        bool ReplaceTable(DWORD tag, std::vector<BYTE>&& table);
+        bool RemoveTable(DWORD tag);
+        bool Write(std::vector<BYTE>& outFontData) const;
+
+    private:
+        struct Table {
+            DWORD tag;
+            DWORD checksum;
+            const BYTE* source;
+            size_t length;
+            bool replaced;
+            std::vector<BYTE> replacement;
+        };
+
+        DWORD version_ = 0;
+        bool recomputeChecksums_ = false;
+        std::vector<Table> tables_;
+    };
+
     // Check if buffer is a valid TTF/OTF (basic check)
     bool IsFontFile(const void* data, size_t size);
     bool IsFontCollection(const void* data, size_t size);
@@ -39,9 +67,28 @@ namespace FontPatcher {
     // Rebuild the name table so a patched in-memory clone can be selected by
     // a unique face name instead of racing the original installed/local font.
     bool PatchNameTableFamily(std::vector<BYTE>& fontData, const wchar_t* familyName);
+    // Same rename written straight into outFontData, leaving fontData intact.
+    // Callers that need a renamed copy skip the copy-then-patch round trip.
+    bool CloneWithNameTableFamily(const std::vector<BYTE>& fontData, const wchar_t* familyName,
+        std::vector<BYTE>& outFontData);
 
     // Rebuild the Unicode cmap so a source codepoint resolves to the glyph
     // used by another codepoint. This is for engines that render through
     // FreeType directly and never call the text APIs where substitution runs.
+    // Aliases cover the full Unicode range and carry format 14 variation
+    // sequences over; the result has format 4 and format 12 subtables.
     bool PatchCmapAliases(std::vector<BYTE>& fontData, const CmapAlias* aliases, size_t aliasCount);
+    // Patches one face of a TTC; the new cmap is appended and only that face's
+    // directory points at it. Standalone fonts accept face 0.
+    bool PatchCmapAliases(std::vector<BYTE>& fontData, DWORD faceIndex,
+        const CmapAlias* aliases, size_t aliasCount);
+
+    // Writes a standalone font that keeps only the outlines reachable from
+    // codepoints: .notdef, the mapped glyphs, GSUB single substitutes such as
+    // vertical forms, and composite components. Glyph ids are retained, so
+    // hmtx, vmtx, maxp and the layout tables stay valid while glyf/loca or the
+    // CFF CharStrings shrink and cmap maps only the requested code points.
+    // Collections and variable fonts are rejected.
+    bool SubsetFont(const std::vector<BYTE>& fontData, const DWORD* codepoints, size_t codepointCount,
+        std::vector<BYTE>& outFontData);
 }
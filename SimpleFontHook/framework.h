@@ -92,6 +92,7 @@ namespace Config {
     extern volatile LONG NeedFontReload;
     extern int DebugSlowMs;
     extern int DebugTraceSampleLimit;
+    extern bool DebugTraceBinary;
     extern int DebugPickerThreadLogLimit;
     extern wchar_t ArtemisFontPath[MAX_PATH];
     extern int ArtemisFontSize;
@@ -114,6 +115,7 @@ namespace Utils {
     std::string GetFontEnglishName(HFONT hFont);
     void SaveConfig(HMODULE hModule);
     bool LoadConfig(HMODULE hModule);
+    std::wstring GetCacheDirectory(HMODULE hModule);
 }
 
 namespace FontHooks {
@@ -0,0 +1,153 @@
+#pragma once
+#include <emmintrin.h>
+#include <cstddef>
+#include <cstdint>
+
+// Table-driven decoding for the DBCS ANSI code pages that dialogue text uses.
+// The DLL reads the tables back from MultiByteToWideChar; the offline check in
+// tools/dbcs_decode_check reads them from iconv and compares. The header only
+// uses fixed-width types, so both build it unchanged.
+//
+// Single bytes are read once per code page; each lead byte's 256 trail units
+// are read the first time that lead is seen. A byte or pair whose isolated
+// conversion is not exactly one UTF-16 unit stays 0 in the table, and any text
+// containing one is handed back to the converter whole, which keeps its
+// default-character rules intact.
+namespace DbcsDecode {
+
+#ifdef _WIN32
+    typedef wchar_t Unit;
+#else
+    typedef char16_t Unit;
+#endif
+
+    // The converter the tables are read from. `convert` follows
+    // MultiByteToWideChar: the unit count written, or 0 when the bytes do not
+    // convert or do not fit `capacity`.
+    struct Converter {
+        bool (*isLeadByte)(unsigned codepage, uint8_t byte);
+        int (*convert)(unsigned codepage, const char* bytes, int length, Unit* output, int capacity);
+    };
+
+    struct Table {
+        unsigned codepage;
+        bool asciiIdentity;         // 0x00-0x7F decode to themselves
+        bool lead[256];
+        bool singleKnown[256];
+        Unit single[256];
+        Unit* volatile pages[256];  // published by the owner, see DecodePair
+    };
+
+    inline void FillTable(Table& table, unsigned codepage, const Converter& converter) {
+        table.codepage = codepage;
+        table.asciiIdentity = true;
+        for (unsigned b = 0; b < 256; ++b) {
+            table.lead[b] = converter.isLeadByte(codepage, (uint8_t)b);
+            table.singleKnown[b] = false;
+            table.single[b] = 0;
+            if (table.lead[b]) continue;
+
+            char byte = (char)b;
+            Unit decoded = 0;
+            if (converter.convert(codepage, &byte, 1, &decoded, 1) == 1) {
+                table.singleKnown[b] = true;
+                table.single[b] = decoded;
+            }
+        }
+        for (unsigned b = 0; b < 0x80; ++b) {
+            if (table.lead[b] || !table.singleKnown[b] || table.single[b] != (Unit)b)
+                table.asciiIdentity = false;
+        }
+    }
+
+    inline void FillPage(Unit* page, unsigned codepage, uint8_t lead, const Converter& converter) {
+        for (unsigned trail = 0; trail < 256; ++trail) {
+            char pair[2] = { (char)lead, (char)trail };
+            Unit decoded[2] = {};
+            page[trail] = converter.convert(codepage, pair, 2, decoded, 2) == 1 ? decoded[0] : 0;
+        }
+    }
+
+    // `pageFor(table, lead)` returns the lead's 256-unit page, building and
+    // publishing it on first use. 0 when the pair has to go through the
+    // converter.
+    template <typename PageFor>
+    inline Unit DecodePair(Table& table, uint8_t lead, uint8_t trail, PageFor pageFor) {
+        return pageFor(table, lead)[trail];
+    }
+
+    // Decodes the character at input[*position] and advances past it. Returns
+    // false when the bytes there have to go through the converter.
+    template <typename PageFor>
+    inline bool DecodeNext(Table& table, const uint8_t* input, int length, int* position, Unit* unit,
+        PageFor pageFor) {
+        int i = *position;
+        uint8_t byte = input[i];
+        if (!table.lead[byte]) {
+            if (!table.singleKnown[byte]) return false;
+            *unit = table.single[byte];
+            *position = i + 1;
+            return true;
+        }
+        if (i + 1 >= length) return false;
+        Unit decoded = DecodePair(table, byte, input[i + 1], pageFor);
+        if (!decoded) return false;
+        *unit = decoded;
+        *position = i + 2;
+        return true;
+    }
+
+    // Decodes a whole string into `output` (at least `length` units), passing
+    // every non-ASCII unit through `map`. Returns the unit count, or -1 when
+    // some byte needs the converter. ASCII runs are widened sixteen bytes per
+    // SSE2 step and stored without `map`.
+    template <typename PageFor, typename Map>
+    inline int DecodeText(Table& table, const uint8_t* input, int length, Unit* output, PageFor pageFor, Map map) {
+        const __m128i zero = _mm_setzero_si128();
+        int written = 0;
+        for (int i = 0; i < length;) {
+            if (table.asciiIdentity && input[i] < 0x80) {
+                for (; i + 16 <= length; i += 16, written += 16) {
+                    __m128i bytes = _mm_loadu_si128((const __m128i*)(input + i));
+                    if (_mm_movemask_epi8(bytes) != 0) break;
+                    _mm_storeu_si128((__m128i*)(output + written), _mm_unpacklo_epi8(bytes, zero));
+                    _mm_storeu_si128((__m128i*)(output + written + 8), _mm_unpackhi_epi8(bytes, zero));
+                }
+                if (i >= length) break;
+            }
+
+            Unit unit;
+            if (!DecodeNext(table, input, length, &i, &unit, pageFor)) return -1;
+            output[written++] = unit < 0x80 ? unit : map(unit);
+        }
+        return written;
+    }
+
+    // Answers DecodeSingleAnsiGlyphChar's question for one glyph code: the code
+    // as a big-endian byte pair, then byte-swapped. Returns 1 when decoded, 0
+    // when the converter would reject both orders, -1 when only the converter
+    // can tell.
+    template <typename PageFor>
+    inline int DecodeGlyphCode(Table& table, uint32_t input, Unit* output, PageFor pageFor) {
+        if (input <= 0xFF) {
+            if (table.lead[input] || !table.singleKnown[input]) return -1;
+            *output = table.single[input];
+            return 1;
+        }
+
+        uint8_t high = (uint8_t)(input >> 8);
+        uint8_t low = (uint8_t)input;
+        if (!table.lead[high]) {
+            // Two single-byte units do not fit a one-unit output; try the swapped pair.
+            if (!table.singleKnown[high]) return -1;
+            if (!table.lead[low]) return table.singleKnown[low] ? 0 : -1;
+            high = (uint8_t)input;
+            low = (uint8_t)(input >> 8);
+        }
+        Unit decoded = DecodePair(table, high, low, pageFor);
+        if (!decoded) return -1;
+        *output = decoded;
+        return 1;
+    }
+
+} // namespace DbcsDecode
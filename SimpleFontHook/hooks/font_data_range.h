@@ -0,0 +1,89 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// GetFontData range and field patches over raw table bytes. The DLL and the
+// offline check in tools/font_data_range_check share this header, so it only
+// uses fixed-width types and no Windows declarations.
+//
+// Table tags are in GDI's byte order: the four tag characters read as a
+// little-endian DWORD, so 'OS/2' is 0x322F534F.
+namespace FontDataRange {
+
+    constexpr uint32_t kTableOS2 = 0x322F534F;
+    constexpr uint32_t kTableHhea = 0x61656868;
+    constexpr uint32_t kTableHead = 0x64616568;
+
+    // GetFontData semantics over one whole table: a size query at offset 0 gets
+    // the table size, a read gets min(cj, size - offset) bytes. Size queries
+    // past the start and reads at or past the end stay with GDI.
+    inline bool Serve(const uint8_t* bytes, size_t size, uint32_t offset, void* buffer, uint32_t cjBuffer,
+        uint32_t* result) {
+        if (!buffer || cjBuffer == 0) {
+            if (offset != 0) return false;
+            *result = (uint32_t)size;
+            return true;
+        }
+        if (offset >= size) return false;
+        uint32_t available = (uint32_t)(size - offset);
+        uint32_t copied = std::min(available, cjBuffer);
+        memcpy(buffer, bytes + offset, copied);
+        *result = copied;
+        return true;
+    }
+
+    // Writes the bytes of a big-endian field that fall inside a buffer holding
+    // table bytes [bufferOffset, bufferOffset + bufferSize).
+    inline void WriteU16BE(uint8_t* buffer, uint32_t bufferOffset, uint32_t bufferSize, uint32_t fieldOffset,
+        uint16_t value) {
+        uint8_t be[2] = {
+            (uint8_t)((value >> 8) & 0xFF),
+            (uint8_t)(value & 0xFF),
+        };
+
+        for (uint32_t i = 0; i < 2; ++i) {
+            uint32_t tablePos = fieldOffset + i;
+            if (tablePos >= bufferOffset && tablePos - bufferOffset < bufferSize) {
+                buffer[tablePos - bufferOffset] = be[i];
+            }
+        }
+    }
+
+    inline void OrU32BitBE(uint8_t* buffer, uint32_t bufferOffset, uint32_t bufferSize, uint32_t fieldOffset,
+        int bitIndex) {
+        if (!buffer || bitIndex < 0 || bitIndex > 31) return;
+        uint32_t tablePos = fieldOffset + (uint32_t)(3 - bitIndex / 8);
+        if (tablePos >= bufferOffset && tablePos - bufferOffset < bufferSize) {
+            buffer[tablePos - bufferOffset] |= (uint8_t)(1u << (bitIndex % 8));
+        }
+    }
+
+    // Sets `bit` and bit 0 of OS/2 ulCodePageRange1 in a returned OS/2 range.
+    inline void PatchCodePageRange(uint32_t table, uint32_t offset, uint8_t* buffer, uint32_t bytesCopied,
+        int bit) {
+        if (!buffer || bytesCopied == 0 || table != kTableOS2 || bit < 0 || bit > 31) return;
+        OrU32BitBE(buffer, offset, bytesCopied, 78, bit);
+        OrU32BitBE(buffer, offset, bytesCopied, 78, 0);
+    }
+
+    // Writes design-unit vertical metrics into a returned hhea or OS/2 range.
+    // The values are already clamped to the signed 16-bit field range.
+    inline void PatchVerticalMetricFields(uint32_t table, uint32_t offset, uint8_t* buffer, uint32_t bytesCopied,
+        int ascent, int descent, int lineGap) {
+        if (!buffer || bytesCopied == 0) return;
+        if (table == kTableHhea) {
+            WriteU16BE(buffer, offset, bytesCopied, 4, (uint16_t)(int16_t)ascent);
+            WriteU16BE(buffer, offset, bytesCopied, 6, (uint16_t)(int16_t)descent);
+            WriteU16BE(buffer, offset, bytesCopied, 8, (uint16_t)(int16_t)lineGap);
+        } else if (table == kTableOS2) {
+            WriteU16BE(buffer, offset, bytesCopied, 68, (uint16_t)(int16_t)ascent);
+            WriteU16BE(buffer, offset, bytesCopied, 70, (uint16_t)(int16_t)descent);
+            WriteU16BE(buffer, offset, bytesCopied, 72, (uint16_t)(int16_t)lineGap);
+            WriteU16BE(buffer, offset, bytesCopied, 74, (uint16_t)std::max(0, std::min(65535, ascent)));
+            WriteU16BE(buffer, offset, bytesCopied, 76, (uint16_t)std::max(0, std::min(65535, -descent)));
+        }
+    }
+
+} // namespace FontDataRange
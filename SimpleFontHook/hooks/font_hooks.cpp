@@ -4,6 +4,14 @@
 #include "../font/font_patcher.h"
 #include "../ui/font_picker.h"
 #include "hook_policy.h"
+#include "trace_binary_format.h"
+#include "font_data_range.h"
+#include "dbcs_decode_table.h"
+#include "replacement_info_index.h"
+#include "glyph_virtual_table.h"
+#include "text_substitution_pages.h"
+#include "metric_page_set.h"
+#include "hdc_decision_cache.h"
 #include "internal/engines/common/engine_common.h"
 #include "internal/engines/common/engine_identity_policy.h"
 #include <detours.h>
@@ -55,6 +63,7 @@ static bool MajiroShouldDecodeAnsiTextAsCp932Wide();
 namespace BgiCompat {
 static bool NormalizeReplacementFontMetrics(const LOGFONTW& sourceLogfont, LOGFONTW& replacementLogfont);
 static bool ShouldCreateAnsiFontThroughWide();
+static bool IsActive();
 static bool BeginTextOutput(HDC hdc, int* y);
 static void EndTextOutput(bool entered);
 static void AdjustTextExtentForHdc(HDC hdc, LPSIZE size);
@@ -66,6 +75,12 @@ static bool ArtemisLegacyTrySubstituteMultiByteToWideChar(UINT codepage, DWORD f
 static bool SubstituteDecodedTextInPlace(LPWSTR text, int count);
 static bool MajiroShouldPreserveDefaultCharset(const LOGFONTW& sourceLogfont);
 static bool SoftpalShouldUseNaturalReplacementWidth();
+static bool IsCurrentReplacementFont(HFONT font);
+template<typename TM> static void PatchTextMetric(HDC hdc, TM* tm);
+static void AdjustWidthArray(LPINT widths, UINT count);
+static void AdjustAbcArray(LPABC abc, UINT count);
+static void DropStaleFontDataCache();
+static void RetireGlyphVirtualTablesLocked();
 
 
 #include "internal/font_hooks_state.cppinc"
@@ -91,6 +106,7 @@ static bool SoftpalShouldUseNaturalReplacementWidth();
 #include "internal/engines/softpal/softpal_default_font.cppinc"
 #include "internal/engines/majiro/majiro_font_cache.cppinc"
 #include "internal/engines/dxlib/dxlib_font_cache.cppinc"
+#include "internal/engines/artemis/artemis_pfs_index.cppinc"
 #include "internal/engines/artemis/artemis_pfs.cppinc"
 #include "internal/engines/artemis/artemis_table_patch.cppinc"
 #include "internal/engines/artemis/artemis_cache.cppinc"
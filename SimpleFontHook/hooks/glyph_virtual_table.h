@@ -0,0 +1,309 @@
+#pragma once
+#include <windows.h>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Per-font glyph alias tables for glyph-index virtualization. The DLL keys them
+// by HFONT; tools/glyph_virtual_bench builds this header on Linux against the
+// Interlocked stand-ins in tools/win32_compat.
+//
+// Each table is split into 256-entry pages allocated on first use. A zero entry
+// means "not assigned"; glyph 0 and 0xFFFF are never virtualized. Tables belong
+// to one config version and are retired as a whole. Writers serialize on a lock
+// the caller owns; readers hold a ReadScope and use tables without locking.
+namespace GlyphVirtual {
+
+    constexpr size_t kPageCount = 256;
+
+    struct Table {
+        volatile LONG configVersion;
+        volatile LONG aliasCount;       // zero until the first alias of this version
+        WORD* volatile realToVirtual[kPageCount];
+        WORD* volatile virtualToReal[kPageCount];
+    };
+
+    template <typename Font>
+    struct Slot {
+        Font volatile font;
+        Table* volatile table;
+    };
+
+    template <typename Font>
+    struct Index {
+        size_t mask;
+        size_t used;
+        Slot<Font>* slots;
+    };
+
+    // The published index plus everything unpublished but possibly still read.
+    template <typename Font>
+    struct Registry {
+        Index<Font>* volatile index = nullptr;
+        std::vector<Index<Font>*> retiredIndexes;
+        std::vector<Table*> retiredTables;
+        volatile LONG readers = 0;
+    };
+
+    template <typename Font>
+    inline size_t Hash(Font font) {
+        uintptr_t value = (uintptr_t)font;
+        value ^= value >> 16;
+        return (size_t)(value * (uintptr_t)0x9E3779B1u);
+    }
+
+    template <typename Font>
+    inline Index<Font>* CreateIndex(size_t capacity) {
+        Index<Font>* index = new Index<Font>();
+        index->mask = capacity - 1;
+        index->used = 0;
+        index->slots = new Slot<Font>[capacity]();
+        return index;
+    }
+
+    inline void FreeTable(Table* table) {
+        for (size_t page = 0; page < kPageCount; ++page) {
+            delete[] table->realToVirtual[page];
+            delete[] table->virtualToReal[page];
+        }
+        delete table;
+    }
+
+    // Lock-free readers hold this scope while they use a table pointer. Retired
+    // tables and indexes are freed only when no reader is inside one.
+    template <typename Font>
+    struct ReadScope {
+        explicit ReadScope(Registry<Font>& owner) : registry(owner) { InterlockedIncrement(&owner.readers); }
+        ~ReadScope() { InterlockedDecrement(&registry.readers); }
+        ReadScope(const ReadScope&) = delete;
+        ReadScope& operator=(const ReadScope&) = delete;
+
+        Registry<Font>& registry;
+    };
+
+    // Anything retired before this call was unpublished first, so a reader that
+    // enters later cannot reach it.
+    template <typename Font>
+    inline void FreeRetiredLocked(Registry<Font>& registry) {
+        if (registry.retiredTables.empty() && registry.retiredIndexes.empty()) return;
+        if (ReadAcquire(&registry.readers) != 0) return;
+
+        for (Table* table : registry.retiredTables) FreeTable(table);
+        for (Index<Font>* index : registry.retiredIndexes) {
+            delete[] index->slots;
+            delete index;
+        }
+        registry.retiredTables.clear();
+        registry.retiredIndexes.clear();
+    }
+
+    // Lock-free lookup. The slot table is insert-only and a font's table pointer
+    // is published before its key, so a visible key always has a usable table.
+    template <typename Font>
+    inline Table* Find(Registry<Font>& registry, Font font) {
+        Index<Font>* index = (Index<Font>*)ReadPointerAcquire((PVOID volatile*)&registry.index);
+        if (!font || !index) return nullptr;
+
+        for (size_t i = Hash(font) & index->mask;; i = (i + 1) & index->mask) {
+            Slot<Font>& slot = index->slots[i];
+            Font observed = (Font)ReadPointerAcquire((PVOID volatile*)&slot.font);
+            if (!observed) return nullptr;
+            if (observed == font)
+                return (Table*)ReadPointerAcquire((PVOID volatile*)&slot.table);
+        }
+    }
+
+    // Returns the font's table when it already belongs to the requested version.
+    template <typename Font>
+    inline Table* FindCurrent(Registry<Font>& registry, Font font, LONG version) {
+        Table* table = Find(registry, font);
+        if (!table || ReadAcquire(&table->configVersion) != version) return nullptr;
+        return table;
+    }
+
+    inline WORD ReadAlias(WORD* volatile const* pages, WORD glyph) {
+        const WORD* page = (const WORD*)ReadPointerAcquire((PVOID volatile*)&pages[glyph >> 8]);
+        return page ? page[glyph & 0xFFu] : 0;
+    }
+
+    inline bool WriteAliasLocked(WORD* volatile* pages, WORD glyph, WORD value) {
+        WORD* page = pages[glyph >> 8];
+        if (!page) {
+            page = new (std::nothrow) WORD[256]();
+            if (!page) return false;
+            InterlockedExchangePointer((PVOID volatile*)&pages[glyph >> 8], page);
+        }
+        page[glyph & 0xFFu] = value;
+        return true;
+    }
+
+    template <typename Font>
+    inline void InsertSlotLocked(Index<Font>* index, Font font, Table* table) {
+        for (size_t i = Hash(font) & index->mask;; i = (i + 1) & index->mask) {
+            Slot<Font>& slot = index->slots[i];
+            if (!slot.font) {
+                InterlockedExchangePointer((PVOID volatile*)&slot.table, table);
+                InterlockedExchangePointer((PVOID volatile*)&slot.font, (PVOID)font);
+                ++index->used;
+                return;
+            }
+        }
+    }
+
+    // Rebuilds the index without fonts `isLive` rejects. Engines that create a
+    // font per line leave one dead handle per line behind.
+    template <typename Font, typename IsLive>
+    inline void PublishLocked(Registry<Font>& registry, Font font, Table* table, IsLive isLive) {
+        Index<Font>* index = registry.index;
+        if (!index) {
+            index = CreateIndex<Font>(64);
+            InterlockedExchangePointer((PVOID volatile*)&registry.index, index);
+        }
+
+        if ((index->used + 1) * 2 > index->mask + 1) {
+            size_t live = 1;
+            for (size_t i = 0; i <= index->mask; ++i) {
+                Font slotFont = index->slots[i].font;
+                if (slotFont && isLive(slotFont)) ++live;
+            }
+            size_t capacity = 64;
+            while (live * 2 > capacity) capacity *= 2;
+
+            Index<Font>* rebuilt = CreateIndex<Font>(capacity);
+            for (size_t i = 0; i <= index->mask; ++i) {
+                Slot<Font>& slot = index->slots[i];
+                if (!slot.font) continue;
+                if (isLive((Font)slot.font)) {
+                    InsertSlotLocked(rebuilt, (Font)slot.font, (Table*)slot.table);
+                } else {
+                    registry.retiredTables.push_back((Table*)slot.table);
+                }
+            }
+            InsertSlotLocked(rebuilt, font, table);
+            InterlockedExchangePointer((PVOID volatile*)&registry.index, rebuilt);
+            registry.retiredIndexes.push_back(index);
+            FreeRetiredLocked(registry);
+            return;
+        }
+
+        InsertSlotLocked(index, font, table);
+    }
+
+    template <typename Font>
+    inline void ReplaceLocked(Registry<Font>& registry, Font font, Table* table) {
+        Index<Font>* index = registry.index;
+        for (size_t i = Hash(font) & index->mask;; i = (i + 1) & index->mask) {
+            Slot<Font>& slot = index->slots[i];
+            if (slot.font != font) continue;
+            registry.retiredTables.push_back((Table*)slot.table);
+            InterlockedExchangePointer((PVOID volatile*)&slot.table, table);
+            return;
+        }
+    }
+
+    // Aliases never cross config versions, so the whole index is unpublished
+    // and freed once readers drain.
+    template <typename Font>
+    inline void RetireAllLocked(Registry<Font>& registry) {
+        Index<Font>* index = (Index<Font>*)InterlockedExchangePointer((PVOID volatile*)&registry.index, nullptr);
+        if (index) {
+            for (size_t i = 0; i <= index->mask; ++i) {
+                if (index->slots[i].font) registry.retiredTables.push_back((Table*)index->slots[i].table);
+            }
+            registry.retiredIndexes.push_back(index);
+        }
+        FreeRetiredLocked(registry);
+    }
+
+    template <typename Font, typename IsLive>
+    inline Table* GetOrCreateLocked(Registry<Font>& registry, Font font, LONG version, IsLive isLive) {
+        FreeRetiredLocked(registry);
+        Table* existing = Find(registry, font);
+        if (existing && existing->configVersion == version) return existing;
+
+        Table* table = new (std::nothrow) Table();
+        if (!table) return nullptr;
+        table->configVersion = version;
+        if (existing) {
+            // A font first used before the epoch refresh observed the new version.
+            ReplaceLocked(registry, font, table);
+        } else {
+            PublishLocked(registry, font, table, isLive);
+        }
+        return table;
+    }
+
+    template <typename Font>
+    inline WORD AssignLocked(Table* table, Font font, LONG version, WORD realGlyph) {
+        WORD existing = ReadAlias(table->realToVirtual, realGlyph);
+        if (existing) return existing;
+
+        WORD salt = (WORD)(((version * 251u) ^ (((uintptr_t)font >> 4) & 0xFFFFu)) & 0xFFFFu);
+        WORD candidate = (WORD)(realGlyph ^ salt);
+        if (candidate == 0 || candidate == 0xFFFF) candidate = (WORD)(realGlyph + 1);
+        if (candidate == 0 || candidate == 0xFFFF) candidate = 1;
+
+        for (int i = 0; i < 0xFFFE; ++i) {
+            WORD mapped = ReadAlias(table->virtualToReal, candidate);
+            if (!mapped || mapped == realGlyph) {
+                // Publish the reverse alias and the count first so a reader that
+                // sees the forward entry can always translate it back.
+                if (!WriteAliasLocked(table->virtualToReal, candidate, realGlyph)) return realGlyph;
+                if (!mapped) InterlockedIncrement(&table->aliasCount);
+                MemoryBarrier();
+                if (!WriteAliasLocked(table->realToVirtual, realGlyph, candidate)) return realGlyph;
+                return candidate;
+            }
+            ++candidate;
+            if (candidate == 0 || candidate == 0xFFFF) candidate = 1;
+        }
+
+        return realGlyph;
+    }
+
+    // Run forms of ReadAlias and AssignLocked for the GDI calls that pass whole
+    // glyph arrays. The caller fetches `table` once inside one ReadScope (and,
+    // for misses, one lock) instead of once per glyph.
+
+    // Replaces every glyph up to the first one without an alias and returns its
+    // position, or `count` when the whole run was known. A null table knows nothing.
+    inline int VirtualizeKnown(const Table* table, WORD* glyphs, int count) {
+        for (int i = 0; i < count; ++i) {
+            WORD glyph = glyphs[i];
+            if (glyph == 0 || glyph == 0xFFFF) continue;
+            WORD virtualGlyph = table ? ReadAlias(table->realToVirtual, glyph) : 0;
+            if (!virtualGlyph) return i;
+            glyphs[i] = virtualGlyph;
+        }
+        return count;
+    }
+
+    template <typename Font>
+    inline void VirtualizeRestLocked(Table* table, Font font, LONG version, WORD* glyphs, int first, int count) {
+        for (int i = first; i < count; ++i) {
+            WORD glyph = glyphs[i];
+            if (glyph == 0 || glyph == 0xFFFF) continue;
+            glyphs[i] = AssignLocked(table, font, version, glyph);
+        }
+    }
+
+    // Position of the first glyph that is an alias of another glyph, or `count`.
+    // Slots 0 and 0xFFFF are never assigned, so reserved glyphs map to themselves.
+    inline int FindFirstVirtual(const Table* table, const WORD* glyphs, int count) {
+        if (!table || ReadAcquire(&table->aliasCount) == 0) return count;
+        for (int i = 0; i < count; ++i) {
+            WORD realGlyph = ReadAlias(table->virtualToReal, glyphs[i]);
+            if (realGlyph && realGlyph != glyphs[i]) return i;
+        }
+        return count;
+    }
+
+    inline void TranslateRun(const Table* table, WORD* glyphs, int first, int count) {
+        for (int i = first; i < count; ++i) {
+            WORD realGlyph = ReadAlias(table->virtualToReal, glyphs[i]);
+            if (realGlyph) glyphs[i] = realGlyph;
+        }
+    }
+
+} // namespace GlyphVirtual
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Per-thread memo of ReplaceHdcFont outcomes. Handles are stored as plain
+// integers; tools/hdc_decision_bench builds this header on Linux and times a
+// hit and a miss against the uncached decision path.
+//
+// An entry matches on (HDC, selected HFONT, config version, registration serial).
+// The serial moves whenever a replacement record is written, so a handle value
+// that GDI recycled through our creation hooks never hits an old decision.
+// Untracked fonts carry a LOGFONT stamp that the caller re-checks on a hit.
+//
+// The table is two-way set associative: a new decision goes to way 0 and pushes
+// the older one to way 1, so two DCs whose keys share a set both stay cached.
+namespace HdcDecision {
+
+    enum Kind : uint8_t {
+        Empty = 0,
+        Skip,               // stock font or already a current replacement
+        Replace,            // select `replacement` for the current font
+    };
+
+    struct Entry {
+        uintptr_t hdc;
+        uintptr_t font;
+        uintptr_t replacement;
+        uintptr_t original;
+        uint64_t sourceStamp;       // LOGFONT hash of an untracked font, 0 otherwise
+        int32_t version;
+        uint32_t serial;
+        int32_t sourceHeight;
+        int32_t sourceWeight;
+        uint8_t kind;
+    };
+
+    constexpr size_t kSets = 16;
+    constexpr size_t kWays = 2;
+
+    struct Cache {
+        Entry entries[kSets][kWays];
+    };
+
+    inline size_t Set(uintptr_t hdc, uintptr_t font) {
+        uint64_t value = (uint64_t)hdc * 0x9E3779B97F4A7C15ull ^ (uint64_t)font;
+        value ^= value >> 29;
+        return (size_t)(value * 0xBF58476D1CE4E5B9ull >> 32) & (kSets - 1);
+    }
+
+    // Eight bytes per multiply; the hit path re-stamps an untracked LOGFONT on
+    // every draw, so a byte-serial hash would cost more than the lookups it skips.
+    inline uint64_t Stamp(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = 1469598103934665603ull;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, bytes + i, sizeof(word));
+            hash = (hash ^ word) * 1099511628211ull;
+            hash ^= hash >> 29;
+        }
+        for (; i < size; ++i) hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash ? hash : 1;
+    }
+
+    inline const Entry* Find(const Cache& cache, uintptr_t hdc, uintptr_t font, int32_t version, uint32_t serial) {
+        for (const Entry& entry : cache.entries[Set(hdc, font)]) {
+            if (entry.kind != Empty && entry.hdc == hdc && entry.font == font &&
+                entry.version == version && entry.serial == serial) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    inline Entry& Claim(Cache& cache, uintptr_t hdc, uintptr_t font, int32_t version, uint32_t serial, uint8_t kind) {
+        Entry* ways = cache.entries[Set(hdc, font)];
+        if (ways[0].hdc != hdc || ways[0].font != font) ways[1] = ways[0];
+        Entry& entry = ways[0];
+        entry = Entry();
+        entry.hdc = hdc;
+        entry.font = font;
+        entry.version = version;
+        entry.serial = serial;
+        entry.kind = kind;
+        return entry;
+    }
+
+    inline void Forget(Cache& cache, uintptr_t hdc, uintptr_t font) {
+        for (Entry& entry : cache.entries[Set(hdc, font)]) {
+            if (entry.hdc == hdc && entry.font == font) entry.kind = Empty;
+        }
+    }
+
+} // namespace HdcDecision
@@ -9,59 +9,27 @@
 namespace HookPolicy {
 
     static __declspec(thread) HookApi g_currentApi = HookApi::Unknown;
-    static __declspec(thread) const char* g_currentApiName = "unknown";
 
-    static bool IsName(const char* left, const char* right) {
-        return left && right && lstrcmpA(left, right) == 0;
-    }
-
-    HookApi ApiFromName(const char* apiName) {
-        if (IsName(apiName, "TextOutA")) return HookApi::TextOutA;
-        if (IsName(apiName, "TextOutW")) return HookApi::TextOutW;
-        if (IsName(apiName, "ExtTextOutA")) return HookApi::ExtTextOutA;
-        if (IsName(apiName, "ExtTextOutW")) return HookApi::ExtTextOutW;
-        if (IsName(apiName, "DrawTextA")) return HookApi::DrawTextA;
-        if (IsName(apiName, "DrawTextW")) return HookApi::DrawTextW;
-        if (IsName(apiName, "DrawTextExA")) return HookApi::DrawTextExA;
-        if (IsName(apiName, "DrawTextExW")) return HookApi::DrawTextExW;
-        if (IsName(apiName, "SelectObject")) return HookApi::SelectObject;
-        if (IsName(apiName, "GetFontData")) return HookApi::GetFontData;
-        if (IsName(apiName, "GetGlyphOutlineA")) return HookApi::GetGlyphOutlineA;
-        if (IsName(apiName, "GetGlyphOutlineW")) return HookApi::GetGlyphOutlineW;
-        if (IsName(apiName, "GetTextMetricsA")) return HookApi::GetTextMetricsA;
-        if (IsName(apiName, "GetTextMetricsW")) return HookApi::GetTextMetricsW;
-        return HookApi::Unknown;
-    }
+    static const char* const kApiNames[] = {
+        "unknown",
+#define HOOK_POLICY_API_NAME(name) #name,
+        HOOK_POLICY_API_LIST(HOOK_POLICY_API_NAME)
+#undef HOOK_POLICY_API_NAME
+    };
+    static_assert(ARRAYSIZE(kApiNames) == (size_t)HookApi::Count, "HookApi name table out of sync");
 
     const char* ApiName(HookApi api) {
-        switch (api) {
-        case HookApi::TextOutA: return "TextOutA";
-        case HookApi::TextOutW: return "TextOutW";
-        case HookApi::ExtTextOutA: return "ExtTextOutA";
-        case HookApi::ExtTextOutW: return "ExtTextOutW";
-        case HookApi::DrawTextA: return "DrawTextA";
-        case HookApi::DrawTextW: return "DrawTextW";
-        case HookApi::DrawTextExA: return "DrawTextExA";
-        case HookApi::DrawTextExW: return "DrawTextExW";
-        case HookApi::SelectObject: return "SelectObject";
-        case HookApi::GetFontData: return "GetFontData";
-        case HookApi::GetGlyphOutlineA: return "GetGlyphOutlineA";
-        case HookApi::GetGlyphOutlineW: return "GetGlyphOutlineW";
-        case HookApi::GetTextMetricsA: return "GetTextMetricsA";
-        case HookApi::GetTextMetricsW: return "GetTextMetricsW";
-        default: return "unknown";
-        }
+        size_t index = (size_t)api;
+        return index < ARRAYSIZE(kApiNames) ? kApiNames[index] : "unknown";
     }
 
-    ApiScope::ApiScope(const char* apiName)
-        : previousApi_(g_currentApi), previousName_(g_currentApiName) {
-        g_currentApi = ApiFromName(apiName);
-        g_currentApiName = apiName ? apiName : ApiName(g_currentApi);
+    ApiScope::ApiScope(HookApi api)
+        : previousApi_(g_currentApi) {
+        g_currentApi = api;
     }
 
     ApiScope::~ApiScope() {
         g_currentApi = previousApi_;
-        g_currentApiName = previousName_;
     }
 
     HookApi CurrentApi() {
@@ -69,7 +37,7 @@ namespace HookPolicy {
     }
 
     const char* CurrentApiName() {
-        return g_currentApiName ? g_currentApiName : "unknown";
+        return ApiName(g_currentApi);
     }
 
     HdcReplaceDecision ShouldReplaceHdcFont(HookApi api, const RuntimeContext& context) {
@@ -3,22 +3,63 @@
 
 namespace HookPolicy {
 
+    // Every hooked entry point that publishes an API context. The enum and the
+    // name table are both generated from this list, so call sites pass a
+    // compile-time identity and names are only resolved when a log line needs one.
+#define HOOK_POLICY_API_LIST(X) \
+    X(TextOutA) \
+    X(TextOutW) \
+    X(ExtTextOutA) \
+    X(ExtTextOutW) \
+    X(DrawTextA) \
+    X(DrawTextW) \
+    X(DrawTextExA) \
+    X(DrawTextExW) \
+    X(SelectObject) \
+    X(GetFontData) \
+    X(GetGlyphOutlineA) \
+    X(GetGlyphOutlineW) \
+    X(GetTextMetricsA) \
+    X(GetTextMetricsW) \
+    X(GetCharABCWidthsA) \
+    X(GetCharABCWidthsFloatA) \
+    X(GetCharABCWidthsFloatW) \
+    X(GetCharABCWidthsI) \
+    X(GetCharABCWidthsW) \
+    X(GetCharWidth32A) \
+    X(GetCharWidth32W) \
+    X(GetCharWidthA) \
+    X(GetCharWidthFloatA) \
+    X(GetCharWidthFloatW) \
+    X(GetCharWidthI) \
+    X(GetCharWidthW) \
+    X(GetCharacterPlacementA) \
+    X(GetCharacterPlacementW) \
+    X(GetFontLanguageInfo) \
+    X(GetFontUnicodeRanges) \
+    X(GetGlyphIndicesA) \
+    X(GetGlyphIndicesW) \
+    X(GetKerningPairsA) \
+    X(GetKerningPairsW) \
+    X(GetOutlineTextMetricsA) \
+    X(GetOutlineTextMetricsW) \
+    X(GetTextCharset) \
+    X(GetTextCharsetInfo) \
+    X(GetTextExtentExPointA) \
+    X(GetTextExtentExPointI) \
+    X(GetTextExtentExPointW) \
+    X(GetTextExtentPoint32A) \
+    X(GetTextExtentPoint32W) \
+    X(GetTextExtentPointA) \
+    X(GetTextExtentPointI) \
+    X(GetTextExtentPointW)
+
     enum class HookApi {
         Unknown = 0,
-        TextOutA,
-        TextOutW,
-        ExtTextOutA,
-        ExtTextOutW,
-        DrawTextA,
-        DrawTextW,
-        DrawTextExA,
-        DrawTextExW,
-        SelectObject,
-        GetFontData,
-        GetGlyphOutlineA,
-        GetGlyphOutlineW,
-        GetTextMetricsA,
-        GetTextMetricsW,
+#define HOOK_POLICY_API_ENUM(name) name,
+        HOOK_POLICY_API_LIST(HOOK_POLICY_API_ENUM)
+#undef HOOK_POLICY_API_ENUM
+        Count,
     };
 
     enum class HookInstallPoint {
@@ -51,15 +92,13 @@ namespace HookPolicy {
 
     class ApiScope {
     public:
-        explicit ApiScope(const char* apiName);
+        explicit ApiScope(HookApi api);
         ~ApiScope();
 
     private:
         HookApi previousApi_;
-        const char* previousName_;
     };
 
-    HookApi ApiFromName(const char* apiName);
     const char* ApiName(HookApi api);
     HookApi CurrentApi();
     const char* CurrentApiName();
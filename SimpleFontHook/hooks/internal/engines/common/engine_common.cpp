@@ -213,6 +213,162 @@ void SearchFontRegistry(HKEY rootKey, REGSAM flags, const std::wstring& targetAl
     RegCloseKey(key);
 }
 
+// Overlay payloads are written once into a delete-on-close temporary file owned
+// by the pool; every open of identical content gets an independent handle with
+// the same read/write access through ReOpenFile. FILE_ATTRIBUTE_TEMPORARY keeps
+// the pages in the cache manager, so repeated opens of the same font or overlay
+// never touch the disk. A config change releases the pool's own handles; files
+// still open in the game are deleted when their last handle closes.
+struct PooledReadFile {
+    HANDLE file;
+    HANDLE mapping;
+    size_t byteCount;
+    unsigned long long contentHash;
+    unsigned long long lastUse;
+};
+
+constexpr size_t kMaxPooledReadFiles = 32;
+constexpr size_t kMaxPooledReadBytes = sizeof(void*) == 4 ? 128u * 1024 * 1024 : 512u * 1024 * 1024;
+constexpr size_t kPooledCompareWindow = 4u * 1024 * 1024;
+constexpr size_t kPayloadHashSamples = 512;
+
+std::mutex g_readFilePoolMutex;
+std::vector<PooledReadFile> g_readFilePool;
+size_t g_readFilePoolBytes = 0;
+unsigned long long g_readFilePoolClock = 0;
+
+unsigned long long MixPayloadWord(unsigned long long hash, const BYTE* bytes) {
+    unsigned long long word = 0;
+    memcpy(&word, bytes, sizeof(word));
+    hash = (hash ^ word) * 1099511628211ull;
+    return hash ^ (hash >> 29);
+}
+
+// The hash only picks candidates for the full compare below, so large payloads
+// are sampled at evenly spaced words instead of hashed end to end.
+unsigned long long HashPayload(const BYTE* bytes, size_t byteCount) {
+    unsigned long long hash = 1469598103934665603ull ^ byteCount;
+    size_t words = byteCount / 8;
+    size_t stride = words > kPayloadHashSamples ? words / kPayloadHashSamples : 1;
+    for (size_t word = 0; word < words; word += stride) hash = MixPayloadWord(hash, bytes + word * 8);
+    if (byteCount >= 8) hash = MixPayloadWord(hash, bytes + byteCount - 8);
+    for (size_t i = words * 8; i < byteCount; ++i) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+void ReleasePooledReadFile(PooledReadFile& entry) {
+    if (entry.mapping) CloseHandle(entry.mapping);
+    if (entry.file != INVALID_HANDLE_VALUE) CloseHandle(entry.file);
+    entry.mapping = nullptr;
+    entry.file = INVALID_HANDLE_VALUE;
+}
+
+// Hash matches are confirmed against the pooled file's current pages, so
+// distinct payloads never share a handle and a pooled file that a caller wrote
+// to is not handed out again. The file is mapped one window at a time to keep
+// the address space cost flat on x86.
+bool PooledReadFileMatches(const PooledReadFile& entry, const BYTE* bytes, size_t byteCount) {
+    if (entry.byteCount != byteCount || !entry.mapping) return false;
+    for (size_t offset = 0; offset < byteCount; offset += kPooledCompareWindow) {
+        size_t windowBytes = (std::min)(kPooledCompareWindow, byteCount - offset);
+        unsigned long long windowOffset = offset;
+        const void* view = MapViewOfFile(entry.mapping, FILE_MAP_READ,
+            static_cast<DWORD>(windowOffset >> 32), static_cast<DWORD>(windowOffset), windowBytes);
+        if (!view) return false;
+        bool same = memcmp(view, bytes + offset, windowBytes) == 0;
+        UnmapViewOfFile(view);
+        if (!same) return false;
+    }
+    return true;
+}
+
+HANDLE CreateDeleteOnCloseFile(const void* bytes, size_t byteCount) {
+    wchar_t tempDirectory[MAX_PATH] = {};
+    wchar_t tempPath[MAX_PATH] = {};
+    if (!GetTempPathW(_countof(tempDirectory), tempDirectory) ||
+        !GetTempFileNameW(tempDirectory, L"sfh", 0, tempPath)) {
+        return INVALID_HANDLE_VALUE;
+    }
+
+    HANDLE file = CreateFileW(tempPath, GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE |
+        FILE_ATTRIBUTE_NOT_CONTENT_INDEXED, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return INVALID_HANDLE_VALUE;
+
+    DWORD written = 0;
+    if (byteCount > 0 && (!WriteFile(file, bytes, static_cast<DWORD>(byteCount),
+        &written, nullptr) || written != byteCount)) {
+        CloseHandle(file);
+        return INVALID_HANDLE_VALUE;
+    }
+    SetFilePointer(file, 0, nullptr, FILE_BEGIN);
+    return file;
+}
+
+// Same access as the private delete-on-close file handed out before pooling.
+HANDLE ReopenPooledReadFile(const PooledReadFile& entry) {
+    return ReOpenFile(entry.file, GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0);
+}
+
+void EvictPooledReadFilesLocked(size_t incomingBytes) {
+    while (!g_readFilePool.empty() &&
+        (g_readFilePool.size() >= kMaxPooledReadFiles ||
+         g_readFilePoolBytes + incomingBytes > kMaxPooledReadBytes)) {
+        auto oldest = std::min_element(g_readFilePool.begin(), g_readFilePool.end(),
+            [](const PooledReadFile& left, const PooledReadFile& right) {
+                return left.lastUse < right.lastUse;
+            });
+        g_readFilePoolBytes -= oldest->byteCount;
+        ReleasePooledReadFile(*oldest);
+        g_readFilePool.erase(oldest);
+    }
+}
+
+// The store keeps blobs of the newest published ConfigVersion. Older blobs are
+// retired: adapters that still borrow them keep them alive, and the weak list
+// only exists so the epoch summary can report that memory.
+struct FontBlobEntry {
+    FontBlobKey key;
+    FontBlob blob;
+};
+
+struct RetiredFontBlob {
+    std::weak_ptr<const std::vector<BYTE>> blob;
+    size_t byteCount;
+};
+
+std::mutex g_fontBlobMutex;
+std::vector<FontBlobEntry> g_fontBlobs;
+std::vector<RetiredFontBlob> g_retiredFontBlobs;
+
+bool SameFontBlobKey(const FontBlobKey& left, const FontBlobKey& right) {
+    return left.configVersion == right.configVersion &&
+        left.weight == right.weight &&
+        left.charset == right.charset &&
+        left.variant == right.variant &&
+        _wcsicmp(left.face.c_str(), right.face.c_str()) == 0;
+}
+
+void PruneRetiredFontBlobsLocked() {
+    g_retiredFontBlobs.erase(std::remove_if(g_retiredFontBlobs.begin(), g_retiredFontBlobs.end(),
+        [](const RetiredFontBlob& retired) { return retired.blob.expired(); }),
+        g_retiredFontBlobs.end());
+}
+
+void RetireFontBlobsBeforeLocked(LONG configVersion) {
+    for (auto it = g_fontBlobs.begin(); it != g_fontBlobs.end();) {
+        if (it->key.configVersion >= configVersion) {
+            ++it;
+            continue;
+        }
+        g_retiredFontBlobs.push_back({ it->blob, it->blob->size() });
+        it = g_fontBlobs.erase(it);
+    }
+    PruneRetiredFontBlobsLocked();
+}
+
 } // namespace
 
 bool IsInternalFileQuery() {
@@ -412,29 +568,89 @@ bool IsReadOnlyOpen(DWORD desiredAccess, DWORD creationDisposition) {
 HANDLE CreateTemporaryReadHandle(const void* bytes, size_t byteCount) {
     if (byteCount > MAXDWORD || (byteCount > 0 && !bytes)) return INVALID_HANDLE_VALUE;
     InternalFileQueryScope queryScope;
-    wchar_t tempDirectory[MAX_PATH] = {};
-    wchar_t tempPath[MAX_PATH] = {};
-    if (!GetTempPathW(_countof(tempDirectory), tempDirectory) ||
-        !GetTempFileNameW(tempDirectory, L"sfh", 0, tempPath)) {
-        return INVALID_HANDLE_VALUE;
-    }
 
-    HANDLE file = CreateFileW(tempPath, GENERIC_READ | GENERIC_WRITE,
-        FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, CREATE_ALWAYS,
-        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE |
-        FILE_ATTRIBUTE_NOT_CONTENT_INDEXED, nullptr);
-    if (file == INVALID_HANDLE_VALUE) return INVALID_HANDLE_VALUE;
+    // Empty payloads and payloads larger than the whole pool get a private file.
+    if (byteCount == 0 || byteCount > kMaxPooledReadBytes)
+        return CreateDeleteOnCloseFile(bytes, byteCount);
 
-    DWORD written = 0;
-    if (byteCount > 0 && (!WriteFile(file, bytes, static_cast<DWORD>(byteCount),
-        &written, nullptr) || written != byteCount)) {
-        CloseHandle(file);
-        return INVALID_HANDLE_VALUE;
+    const BYTE* payload = static_cast<const BYTE*>(bytes);
+    unsigned long long contentHash = HashPayload(payload, byteCount);
+    std::lock_guard<std::mutex> lock(g_readFilePoolMutex);
+    for (PooledReadFile& entry : g_readFilePool) {
+        if (entry.contentHash != contentHash || !PooledReadFileMatches(entry, payload, byteCount))
+            continue;
+        HANDLE file = ReopenPooledReadFile(entry);
+        if (file != INVALID_HANDLE_VALUE) {
+            entry.lastUse = ++g_readFilePoolClock;
+            return file;
+        }
     }
-    SetFilePointer(file, 0, nullptr, FILE_BEGIN);
+
+    EvictPooledReadFilesLocked(byteCount);
+    PooledReadFile entry = {};
+    entry.file = CreateDeleteOnCloseFile(bytes, byteCount);
+    if (entry.file == INVALID_HANDLE_VALUE) return INVALID_HANDLE_VALUE;
+    entry.mapping = CreateFileMappingW(entry.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    HANDLE file = entry.mapping ? ReopenPooledReadFile(entry) : INVALID_HANDLE_VALUE;
+    if (file == INVALID_HANDLE_VALUE) {
+        // Hand the writer handle itself to the caller, as before pooling.
+        if (entry.mapping) CloseHandle(entry.mapping);
+        return entry.file;
+    }
+
+    entry.byteCount = byteCount;
+    entry.contentHash = contentHash;
+    entry.lastUse = ++g_readFilePoolClock;
+    g_readFilePool.push_back(entry);
+    g_readFilePoolBytes += byteCount;
     return file;
 }
 
+void ReleaseTemporaryReadPool() {
+    std::lock_guard<std::mutex> lock(g_readFilePoolMutex);
+    for (PooledReadFile& entry : g_readFilePool) ReleasePooledReadFile(entry);
+    g_readFilePool.clear();
+    g_readFilePoolBytes = 0;
+}
+
+FontBlob FindFontBlob(const FontBlobKey& key) {
+    std::lock_guard<std::mutex> lock(g_fontBlobMutex);
+    for (const FontBlobEntry& entry : g_fontBlobs) {
+        if (SameFontBlobKey(entry.key, key)) return entry.blob;
+    }
+    return FontBlob();
+}
+
+// The first blob published for a key wins, so concurrent producers converge on
+// one copy.
+FontBlob PublishFontBlob(const FontBlobKey& key, std::vector<BYTE>&& bytes) {
+    if (bytes.empty()) return FontBlob();
+    std::lock_guard<std::mutex> lock(g_fontBlobMutex);
+    for (const FontBlobEntry& entry : g_fontBlobs) {
+        if (SameFontBlobKey(entry.key, key)) return entry.blob;
+    }
+
+    RetireFontBlobsBeforeLocked(key.configVersion);
+    FontBlob blob = std::make_shared<const std::vector<BYTE>>(std::move(bytes));
+    g_fontBlobs.push_back({ key, blob });
+    return blob;
+}
+
+FontBlobStats QueryFontBlobStats() {
+    FontBlobStats stats = {};
+    std::lock_guard<std::mutex> lock(g_fontBlobMutex);
+    PruneRetiredFontBlobsLocked();
+    for (const FontBlobEntry& entry : g_fontBlobs) {
+        ++stats.cachedCount;
+        stats.cachedBytes += entry.blob->size();
+    }
+    for (const RetiredFontBlob& retired : g_retiredFontBlobs) {
+        ++stats.retiredCount;
+        stats.retiredBytes += retired.byteCount;
+    }
+    return stats;
+}
+
 bool ModuleContainsAscii(HMODULE module, const char* marker) {
     return marker && marker[0] && ModuleContainsBytes(module, marker, strlen(marker));
 }
@@ -2,7 +2,9 @@
 
 #include <windows.h>
 #include <cstddef>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "engine_identity_policy.h"
 
@@ -25,6 +27,30 @@ std::wstring FindLocalFontFile(const wchar_t* configuredFileName);
 bool LooksLikeSfnt(const void* bytes, size_t byteCount);
 bool IsReadOnlyOpen(DWORD desiredAccess, DWORD creationDisposition);
 HANDLE CreateTemporaryReadHandle(const void* bytes, size_t byteCount);
+// Closes the pool's handles to payloads of earlier settings.
+void ReleaseTemporaryReadPool();
+
+// Immutable font bytes shared by every adapter that serves the same font.
+using FontBlob = std::shared_ptr<const std::vector<BYTE>>;
+
+struct FontBlobKey {
+    std::wstring face;
+    LONG weight;
+    BYTE charset;
+    std::string variant;        // producer and patch parameters
+    LONG configVersion;
+};
+
+struct FontBlobStats {
+    size_t cachedCount;
+    unsigned long long cachedBytes;
+    size_t retiredCount;        // evicted but still borrowed by an adapter
+    unsigned long long retiredBytes;
+};
+
+FontBlob FindFontBlob(const FontBlobKey& key);
+FontBlob PublishFontBlob(const FontBlobKey& key, std::vector<BYTE>&& bytes);
+FontBlobStats QueryFontBlobStats();
 bool IsInternalFileQuery();
 
 bool ModuleContainsAscii(HMODULE module, const char* marker);
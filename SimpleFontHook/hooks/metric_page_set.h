@@ -0,0 +1,61 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+// Per-character metric pages for one font: 256 entries per page over the BMP,
+// allocated when the first character of a page is measured. The DLL fills a
+// page with one GetCharWidth32W / GetCharABCWidthsW call and answers every
+// later query in that range by copying; tools/metric_page_bench times the fill
+// and the per-character reads on Linux. Callers serialize access.
+namespace MetricPages {
+
+    constexpr uint32_t kPageShift = 8;
+    constexpr uint32_t kPageSize = 1u << kPageShift;
+    constexpr uint32_t kPageCount = 0x10000u >> kPageShift;
+
+    template <typename T>
+    struct Set {
+        std::unique_ptr<T[]> pages[kPageCount];
+        bool unavailable;           // the font cannot answer this query at all
+    };
+
+    inline bool RangeValid(uint32_t first, uint32_t last) {
+        return first <= last && last < 0x10000u;
+    }
+
+    // First page in [first, last] that still has to be filled, or kPageCount.
+    template <typename T>
+    inline uint32_t FindMissing(const Set<T>& set, uint32_t first, uint32_t last) {
+        for (uint32_t page = first >> kPageShift; page <= (last >> kPageShift); ++page) {
+            if (!set.pages[page]) return page;
+        }
+        return kPageCount;
+    }
+
+    // A page filled by a racing thread wins; both came from the same font.
+    template <typename T>
+    inline void Store(Set<T>& set, uint32_t page, const T* values) {
+        if (page >= kPageCount || set.pages[page]) return;
+        std::unique_ptr<T[]> stored(new T[kPageSize]);
+        memcpy(stored.get(), values, kPageSize * sizeof(T));
+        set.pages[page] = std::move(stored);
+    }
+
+    template <typename T>
+    inline bool Read(const Set<T>& set, uint32_t first, uint32_t last, T* out) {
+        if (!RangeValid(first, last) || FindMissing(set, first, last) != kPageCount) return false;
+
+        for (uint32_t code = first; code <= last;) {
+            const T* page = set.pages[code >> kPageShift].get();
+            uint32_t offset = code & (kPageSize - 1);
+            uint32_t take = std::min(kPageSize - offset, last - code + 1);
+            memcpy(out, page + offset, take * sizeof(T));
+            out += take;
+            code += take;
+        }
+        return true;
+    }
+
+} // namespace MetricPages
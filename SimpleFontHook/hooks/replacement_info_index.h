@@ -0,0 +1,133 @@
+#pragma once
+#include <windows.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Insert-only open-addressing index from a handle to a small record, read
+// without locks. The DLL keys it by HFONT; tools/replacement_index_bench builds
+// it on Linux against the Interlocked stand-ins in tools/win32_compat.
+//
+// Writers serialize on a lock the caller owns. Readers probe the current table
+// and validate each record with its per-slot sequence: odd while a writer is
+// replacing the record, bumped again when it is done. Slots are never removed,
+// and a grown table is retired instead of freed, so a reader holding an old
+// table pointer still sees complete records.
+namespace ReplacementInfoIndex {
+
+    template <typename Key, typename Value>
+    struct Slot {
+        Key volatile key;
+        volatile LONG sequence;
+        Value value;
+    };
+
+    template <typename Key, typename Value>
+    struct Table {
+        size_t mask;
+        size_t used;
+        Slot<Key, Value>* slots;
+    };
+
+    template <typename Key>
+    inline size_t Hash(Key key) {
+        uintptr_t value = (uintptr_t)key;
+        value ^= value >> 16;
+        return (size_t)(value * (uintptr_t)0x9E3779B1u);
+    }
+
+    template <typename Key, typename Value>
+    inline Table<Key, Value>* Create(size_t capacity) {
+        Table<Key, Value>* table = new Table<Key, Value>();
+        table->mask = capacity - 1;
+        table->used = 0;
+        table->slots = new Slot<Key, Value>[capacity]();
+        return table;
+    }
+
+    template <typename Key, typename Value>
+    inline Table<Key, Value>* Current(Table<Key, Value>* volatile const& head) {
+        return (Table<Key, Value>*)ReadPointerAcquire((PVOID volatile*)&head);
+    }
+
+    template <typename Key, typename Value>
+    inline bool ReadSlot(Slot<Key, Value>& slot, Value* value) {
+        if (!value) return true;
+        for (;;) {
+            LONG before = ReadAcquire(&slot.sequence);
+            if (before & 1) {
+                YieldProcessor();
+                continue;
+            }
+            Value snapshot;
+            memcpy(&snapshot, (const void*)&slot.value, sizeof(snapshot));
+            MemoryBarrier();
+            if (ReadNoFence(&slot.sequence) == before) {
+                *value = snapshot;
+                return true;
+            }
+        }
+    }
+
+    // Lock-free lookup; `value` may be null to test membership only.
+    template <typename Key, typename Value>
+    inline bool Find(Table<Key, Value>* volatile const& head, Key key, Value* value) {
+        Table<Key, Value>* table = Current(head);
+        if (!key || !table) return false;
+
+        for (size_t i = Hash(key) & table->mask;; i = (i + 1) & table->mask) {
+            Slot<Key, Value>& slot = table->slots[i];
+            Key observed = (Key)ReadPointerAcquire((PVOID volatile*)&slot.key);
+            if (!observed) return false;
+            if (observed == key) return ReadSlot(slot, value);
+        }
+    }
+
+    template <typename Key, typename Value>
+    inline void InsertLocked(Table<Key, Value>* table, Key key, const Value& value) {
+        for (size_t i = Hash(key) & table->mask;; i = (i + 1) & table->mask) {
+            Slot<Key, Value>& slot = table->slots[i];
+            if (slot.key == key) {
+                InterlockedIncrement(&slot.sequence);
+                memcpy((void*)&slot.value, &value, sizeof(value));
+                InterlockedIncrement(&slot.sequence);
+                return;
+            }
+            if (!slot.key) {
+                memcpy((void*)&slot.value, &value, sizeof(value));
+                InterlockedExchangePointer((PVOID volatile*)&slot.key, (PVOID)key);
+                ++table->used;
+                return;
+            }
+        }
+    }
+
+    // Inserts or replaces the record for `key`. The caller holds the writer lock.
+    template <typename Key, typename Value>
+    inline void StoreLocked(Table<Key, Value>* volatile& head, std::vector<Table<Key, Value>*>& retired,
+        Key key, const Value& value) {
+        Table<Key, Value>* table = head;
+        if (!table) {
+            table = Create<Key, Value>(256);
+            InterlockedExchangePointer((PVOID volatile*)&head, table);
+        }
+
+        // Keep the load factor under one half so probe chains stay short. Readers
+        // may still be walking the old table, so it is retired instead of freed.
+        if ((table->used + 1) * 2 > table->mask + 1) {
+            Table<Key, Value>* grown = Create<Key, Value>((table->mask + 1) * 2);
+            for (size_t i = 0; i <= table->mask; ++i) {
+                if (table->slots[i].key)
+                    InsertLocked(grown, (Key)table->slots[i].key, table->slots[i].value);
+            }
+            InsertLocked(grown, key, value);
+            InterlockedExchangePointer((PVOID volatile*)&head, grown);
+            retired.push_back(table);
+            return;
+        }
+
+        InsertLocked(table, key, value);
+    }
+
+} // namespace ReplacementInfoIndex
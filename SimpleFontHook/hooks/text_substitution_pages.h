@@ -0,0 +1,121 @@
+#pragma once
+#include <emmintrin.h>
+#include <cstddef>
+#include <cstdint>
+
+// Two-level BMP lookup for text substitution, built from the sorted pair tables
+// at compile time. The high byte of a UTF-16 unit selects a page and the low byte
+// selects the replacement; page 0 is all zero and shared by every unmapped high
+// byte. tools/text_substitution_bench builds this header on Linux with
+// -fshort-wchar so that wchar_t is a UTF-16 unit there too.
+namespace TextSubstitutionPages {
+
+    template <typename Pair, size_t N>
+    constexpr size_t CountPages(const Pair (&pairs)[N]) {
+        bool seen[256] = {};
+        size_t pages = 0;
+        for (size_t i = 0; i < N; ++i) {
+            unsigned high = ((unsigned)pairs[i].from >> 8) & 0xFFu;
+            if (!seen[high]) {
+                seen[high] = true;
+                ++pages;
+            }
+        }
+        return pages;
+    }
+
+    template <size_t PageCount>
+    struct Pages {
+        unsigned char pageIndex[256];
+        wchar_t pages[PageCount + 1][256];
+    };
+
+    template <size_t PageCount, typename Pair, size_t N>
+    constexpr Pages<PageCount> Build(const Pair (&pairs)[N]) {
+        static_assert(PageCount < 256, "text substitution page index must fit in one byte");
+        Pages<PageCount> table = {};
+        unsigned char nextPage = 1;
+        for (size_t i = 0; i < N; ++i) {
+            unsigned high = ((unsigned)pairs[i].from >> 8) & 0xFFu;
+            if (table.pageIndex[high] == 0) table.pageIndex[high] = nextPage++;
+            table.pages[table.pageIndex[high]][(unsigned)pairs[i].from & 0xFFu] = pairs[i].to;
+        }
+        return table;
+    }
+
+    template <typename Pair>
+    struct Table {
+        const Pair* pairs;
+        size_t count;
+        const unsigned char* pageIndex;
+        const wchar_t (*pages)[256];
+        const char* name;
+    };
+
+    template <typename Pair>
+    inline bool IsMappedPage(const Table<Pair>& table, wchar_t ch) {
+        return table.pageIndex[((unsigned)ch >> 8) & 0xFFu] != 0;
+    }
+
+    template <typename Pair>
+    inline wchar_t LookupUnit(const Table<Pair>& table, wchar_t ch) {
+        return table.pages[table.pageIndex[((unsigned)ch >> 8) & 0xFFu]][(unsigned)ch & 0xFFu];
+    }
+
+    // Returns the first index at or after start whose code unit sits on a mapped
+    // page. Eight UTF-16 units per SSE2 step: a block entirely below the first
+    // mapped unit (ASCII and Latin text) passes on one compare; any other block
+    // has each lane's high byte tested against the page index, so kana,
+    // fullwidth punctuation and other unmapped pages are skipped as well.
+    template <typename Pair>
+    inline int SkipUnmappedRun(const Table<Pair>& table, const wchar_t* text, int start, int length) {
+        if (!table.pairs || table.count == 0 || !table.pageIndex) return length;
+        const unsigned char* pageIndex = table.pageIndex;
+        int i = start;
+        const __m128i bias = _mm_set1_epi16((short)0x8000);
+        const __m128i limit = _mm_set1_epi16((short)(table.pairs[0].from ^ 0x8000));
+        for (; i + 8 <= length; i += 8) {
+            __m128i units = _mm_loadu_si128((const __m128i*)(text + i));
+            if (_mm_movemask_epi8(_mm_cmplt_epi16(_mm_xor_si128(units, bias), limit)) == 0xFFFF) continue;
+
+            __m128i high = _mm_srli_epi16(units, 8);
+            high = _mm_packus_epi16(high, high);
+            uint32_t lanes0 = (uint32_t)_mm_cvtsi128_si32(high);
+            uint32_t lanes4 = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(high, 4));
+            unsigned mapped =
+                pageIndex[lanes0 & 0xFFu] | pageIndex[(lanes0 >> 8) & 0xFFu] |
+                pageIndex[(lanes0 >> 16) & 0xFFu] | pageIndex[lanes0 >> 24] |
+                pageIndex[lanes4 & 0xFFu] | pageIndex[(lanes4 >> 8) & 0xFFu] |
+                pageIndex[(lanes4 >> 16) & 0xFFu] | pageIndex[lanes4 >> 24];
+            if (mapped) break;
+        }
+        while (i < length && !IsMappedPage(table, text[i])) ++i;
+        return i;
+    }
+
+    // The candidate after index `current`. Units on a mapped page go straight to
+    // the lookup; the SSE2 skip restarts only at a unit on an unmapped page.
+    template <typename Pair>
+    inline int NextCandidate(const Table<Pair>& table, const wchar_t* text, int current, int length) {
+        int next = current + 1;
+        if (next < length && IsMappedPage(table, text[next])) return next;
+        return SkipUnmappedRun(table, text, next, length);
+    }
+
+    // Substitutes text[start, length) in place and returns the number of units
+    // replaced.
+    template <typename Pair>
+    inline int SubstituteRunInPlace(const Table<Pair>& table, wchar_t* text, int start, int length) {
+        int changed = 0;
+        for (int i = SkipUnmappedRun(table, text, start, length); i < length;
+            i = NextCandidate(table, text, i, length)) {
+            wchar_t replacement = LookupUnit(table, text[i]);
+            if (replacement) {
+                text[i] = replacement;
+                ++changed;
+            }
+        }
+        return changed;
+    }
+
+} // namespace TextSubstitutionPages
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+
+// Layout of FontHook.trace.bin. The DLL writer and the offline decoder share this
+// header, so it only uses fixed-width types and no Windows declarations.
+//
+// File: [FileHeader, padded to headerSize][FormatEntry x formatCapacity][Record x recordCapacity]
+namespace TraceBinary {
+
+    constexpr char kMagic[8] = { 'S', 'F', 'H', 'T', 'R', 'A', 'C', 'E' };
+    constexpr uint32_t kFormatVersion = 1;
+    constexpr uint32_t kHeaderSize = 4096;
+    constexpr uint32_t kMaxArgs = 8;
+    constexpr uint32_t kMaxKinds = 16;
+    constexpr uint32_t kKindNameSize = 32;
+    constexpr uint32_t kFormatCapacity = 256;
+    constexpr uint32_t kFormatEntrySize = 192;
+    constexpr uint32_t kRecordCapacity = 65536;
+    constexpr uint16_t kNoFormat = 0xFFFF;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t formatVersion;
+        uint32_t headerSize;
+        uint32_t recordSize;
+        uint32_t recordCapacity;
+        uint32_t formatEntrySize;
+        uint32_t formatCapacity;
+        uint32_t pointerSize;
+        uint32_t processId;
+        int64_t qpcFrequency;
+        int64_t startQpc;
+        uint64_t startFileTime;     // UTC FILETIME of the first record
+        uint64_t nextSequence;      // last sequence handed out; records are 1-based
+        uint32_t formatCount;
+        uint32_t kindCount;
+        char kindNames[kMaxKinds][kKindNameSize];
+    };
+
+    // printf-style detail format registered once per call site. Argument slots of
+    // a record are decoded against its conversions.
+    struct FormatEntry {
+        char text[kFormatEntrySize];
+    };
+
+    // Integer conversions are stored widened to 64 bits: %d/%i sign-extended,
+    // unsigned conversions and %p zero-extended.
+    struct Record {
+        uint64_t sequence;          // 0 while the slot is empty or being rewritten
+        int64_t qpc;
+        uint32_t threadId;
+        int32_t configVersion;
+        uint16_t kind;
+        uint16_t formatId;
+        uint16_t argCount;
+        uint16_t reserved;
+        uint64_t args[kMaxArgs];
+    };
+
+    static_assert(sizeof(FileHeader) <= kHeaderSize, "trace header exceeds reserved size");
+    static_assert(sizeof(Record) == 96, "trace record layout changed");
+
+    constexpr uint64_t kFormatTableOffset = kHeaderSize;
+    constexpr uint64_t kRecordTableOffset = kFormatTableOffset + (uint64_t)kFormatCapacity * kFormatEntrySize;
+    constexpr uint64_t kFileSize = kRecordTableOffset + (uint64_t)kRecordCapacity * sizeof(Record);
+}
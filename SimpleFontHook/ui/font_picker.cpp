@@ -36,6 +36,7 @@ namespace FontPicker {
 
 #include "internal/font_picker_state_layout.cppinc"
 #include "internal/font_picker_apply_config.cppinc"
+#include "internal/font_picker_clone_cache.cppinc"
 #include "internal/font_picker_font_list.cppinc"
 #include "internal/font_picker_paint.cppinc"
 #include "internal/font_picker_input.cppinc"
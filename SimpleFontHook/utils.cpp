@@ -93,6 +93,7 @@ namespace Config {
     volatile LONG NeedFontReload = 0;
     int DebugSlowMs = 50;
     int DebugTraceSampleLimit = 0;
+    bool DebugTraceBinary = false;
     int DebugPickerThreadLogLimit = 0;
     wchar_t ArtemisFontPath[MAX_PATH] = L"";
     int ArtemisFontSize = 0;
@@ -130,6 +131,27 @@ namespace Utils {
     static char g_fontSwitchWatchFont[LF_FACESIZE * 4] = {};
     static std::mutex g_traceFileMutex;
     static bool g_traceSessionInitialized = false;
+    static HANDLE g_traceFile = INVALID_HANDLE_VALUE;
+    static bool g_traceFileReleased = false; // guarded by g_traceFileMutex
+
+    // Trace lines are formatted by the calling thread and pushed into a bounded
+    // multi-producer ring. One writer thread drains it through a single open
+    // handle; crash and watchdog output still writes synchronously.
+    struct TraceRecordSlot {
+        volatile LONG64 sequence;
+        DWORD length;
+        char text[500];
+    };
+
+    static const LONG64 kTraceRingCapacity = 1024;
+    static TraceRecordSlot g_traceRing[kTraceRingCapacity] = {};
+    static volatile LONG64 g_traceEnqueuePos = 0;
+    static LONG64 g_traceDequeuePos = 0; // guarded by g_traceFileMutex
+    static volatile LONG g_traceDroppedRecords = 0;
+    static volatile LONG g_traceWriterState = 0; // 0 idle, 1 starting, 2 running, 3 direct-only
+    static HANDLE g_traceWriterThread = NULL;
+    static HANDLE g_traceWriterEvent = NULL;
+    static char g_traceBatch[64 * 1024] = {}; // guarded by g_traceFileMutex
 
     static void GetTracePath(wchar_t* path, size_t count) {
         if (!path || count == 0) return;
@@ -139,42 +161,164 @@ namespace Utils {
         PathAppendW(path, L"FontHook.trace.log");
     }
 
-    static bool EnsureTraceSessionInitializedLocked(wchar_t* path,
-        size_t count) {
-        GetTracePath(path, count);
-        if (!path || !path[0]) return false;
-        if (g_traceSessionInitialized) return true;
+    static bool EnsureTraceFileLocked() {
+        if (g_traceFile != INVALID_HANDLE_VALUE) return true;
 
-        HANDLE hFile = CreateFileW(path, GENERIC_WRITE,
-            FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, CREATE_ALWAYS,
-            FILE_ATTRIBUTE_NORMAL, NULL);
-        if (hFile == INVALID_HANDLE_VALUE) return false;
-        CloseHandle(hFile);
-        g_traceSessionInitialized = true;
-        return true;
-    }
-
-    static void AppendTraceLineDirect(const char* message) {
-        if (!message) return;
-
-        std::lock_guard<std::mutex> lock(g_traceFileMutex);
         wchar_t path[MAX_PATH] = {};
-        if (!EnsureTraceSessionInitializedLocked(path, _countof(path))) return;
+        GetTracePath(path, _countof(path));
+        if (!path[0]) return false;
+
+        if (!g_traceSessionInitialized) {
+            HANDLE hFile = CreateFileW(path, GENERIC_WRITE,
+                FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, CREATE_ALWAYS,
+                FILE_ATTRIBUTE_NORMAL, NULL);
+            if (hFile == INVALID_HANDLE_VALUE) return false;
+            CloseHandle(hFile);
+            g_traceSessionInitialized = true;
+        }
 
-        HANDLE hFile = CreateFileW(path, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+        g_traceFile = CreateFileW(path, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
             OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-        if (hFile == INVALID_HANDLE_VALUE) return;
+        return g_traceFile != INVALID_HANDLE_VALUE;
+    }
+
+    static void WriteTraceBytesLocked(const char* data, DWORD length) {
+        if (!data || length == 0 || !EnsureTraceFileLocked()) return;
+        DWORD written = 0;
+        WriteFile(g_traceFile, data, length, &written, NULL);
+        // After diagnostics shut down, late lines open the file for one write only.
+        if (g_traceFileReleased) {
+            CloseHandle(g_traceFile);
+            g_traceFile = INVALID_HANDLE_VALUE;
+        }
+    }
 
+    static int FormatTraceLine(char* line, size_t count, const char* message) {
         SYSTEMTIME st = {};
         GetLocalTime(&st);
-        char line[4096] = {};
-        sprintf_s(line, "[%02u:%02u:%02u.%03u][pid=%lu][tid=%lu] %s\r\n",
+        return sprintf_s(line, count, "[%02u:%02u:%02u.%03u][pid=%lu][tid=%lu] %s\r\n",
             st.wHour, st.wMinute, st.wSecond, st.wMilliseconds,
             GetCurrentProcessId(), GetCurrentThreadId(), message);
+    }
 
-        DWORD written = 0;
-        WriteFile(hFile, line, (DWORD)strlen(line), &written, NULL);
-        CloseHandle(hFile);
+    // Single consumer at a time: both the writer thread and the synchronous paths
+    // hold g_traceFileMutex while draining.
+    static void DrainTraceRingLocked() {
+        DWORD batched = 0;
+        for (;;) {
+            TraceRecordSlot& slot = g_traceRing[g_traceDequeuePos & (kTraceRingCapacity - 1)];
+            if (InterlockedCompareExchange64(&slot.sequence, 0, 0) != g_traceDequeuePos + 1)
+                break;
+
+            if (batched + slot.length > sizeof(g_traceBatch)) {
+                WriteTraceBytesLocked(g_traceBatch, batched);
+                batched = 0;
+            }
+            memcpy(g_traceBatch + batched, slot.text, slot.length);
+            batched += slot.length;
+            InterlockedExchange64(&slot.sequence, g_traceDequeuePos + kTraceRingCapacity);
+            ++g_traceDequeuePos;
+        }
+
+        LONG dropped = InterlockedExchange(&g_traceDroppedRecords, 0);
+        if (dropped > 0) {
+            char message[128] = {};
+            sprintf_s(message, "[TRACE] ring overflow dropped=%ld", dropped);
+            char line[256] = {};
+            int length = FormatTraceLine(line, sizeof(line), message);
+            if (length > 0 && batched + (DWORD)length <= sizeof(g_traceBatch)) {
+                memcpy(g_traceBatch + batched, line, length);
+                batched += (DWORD)length;
+            }
+        }
+
+        WriteTraceBytesLocked(g_traceBatch, batched);
+    }
+
+    static void TryDrainTraceRing() {
+        if (!g_traceFileMutex.try_lock()) return;
+        DrainTraceRingLocked();
+        g_traceFileMutex.unlock();
+    }
+
+    static DWORD WINAPI TraceWriterThread(void*) {
+        for (;;) {
+            WaitForSingleObject(g_traceWriterEvent, 100);
+            bool stopping = IsShuttingDown();
+            {
+                std::lock_guard<std::mutex> lock(g_traceFileMutex);
+                DrainTraceRingLocked();
+            }
+            if (stopping) break;
+        }
+        InterlockedExchange(&g_traceWriterState, 3);
+        return 0;
+    }
+
+    static bool EnsureTraceWriterStarted() {
+        LONG state = InterlockedCompareExchange(&g_traceWriterState, 1, 0);
+        if (state != 0) return state == 2;
+
+        for (LONG64 i = 0; i < kTraceRingCapacity; ++i)
+            g_traceRing[i].sequence = i;
+        g_traceWriterEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+        g_traceWriterThread = g_traceWriterEvent
+            ? CreateThread(NULL, 0, TraceWriterThread, NULL, 0, NULL)
+            : NULL;
+        InterlockedExchange(&g_traceWriterState, g_traceWriterThread ? 2 : 3);
+        return g_traceWriterThread != NULL;
+    }
+
+    // Returns false when the caller must write the line itself (oversized line,
+    // writer not running). A full ring is drained by the producer when the file
+    // lock is free, otherwise the record is counted as dropped.
+    static bool TryEnqueueTraceLine(const char* line, size_t length) {
+        if (length > sizeof(g_traceRing[0].text) || IsShuttingDown() || !EnsureTraceWriterStarted())
+            return false;
+
+        bool helped = false;
+        LONG64 position = InterlockedCompareExchange64(&g_traceEnqueuePos, 0, 0);
+        for (;;) {
+            TraceRecordSlot& slot = g_traceRing[position & (kTraceRingCapacity - 1)];
+            LONG64 sequence = InterlockedCompareExchange64(&slot.sequence, 0, 0);
+            if (sequence == position) {
+                LONG64 observed = InterlockedCompareExchange64(&g_traceEnqueuePos, position + 1, position);
+                if (observed != position) {
+                    position = observed;
+                    continue;
+                }
+                memcpy(slot.text, line, length);
+                slot.length = (DWORD)length;
+                InterlockedExchange64(&slot.sequence, position + 1);
+                if ((position & (kTraceRingCapacity / 4 - 1)) == 0)
+                    SetEvent(g_traceWriterEvent);
+                return true;
+            }
+
+            if (sequence < position) {
+                if (!helped) {
+                    helped = true;
+                    TryDrainTraceRing();
+                    position = InterlockedCompareExchange64(&g_traceEnqueuePos, 0, 0);
+                    continue;
+                }
+                InterlockedIncrement(&g_traceDroppedRecords);
+                return true;
+            }
+
+            position = InterlockedCompareExchange64(&g_traceEnqueuePos, 0, 0);
+        }
+    }
+
+    static void AppendTraceLineDirect(const char* message) {
+        if (!message) return;
+
+        char line[4096] = {};
+        int length = FormatTraceLine(line, sizeof(line), message);
+
+        std::lock_guard<std::mutex> lock(g_traceFileMutex);
+        DrainTraceRingLocked();
+        if (length > 0) WriteTraceBytesLocked(line, (DWORD)length);
     }
 
     static bool ModuleInfoFromAddress(const void* address, uintptr_t* baseOut,
@@ -450,6 +594,8 @@ namespace Utils {
         InterlockedExchange(&g_shutdownRequested, 1);
         HANDLE event = g_diagnosticsStopEvent;
         if (event) SetEvent(event);
+        HANDLE traceEvent = g_traceWriterEvent;
+        if (traceEvent) SetEvent(traceEvent);
     }
 
     bool IsShuttingDown() {
@@ -467,6 +613,23 @@ namespace Utils {
         }
         if (thread) CloseHandle(thread);
 
+        HANDLE traceThread = (HANDLE)InterlockedExchangePointer(
+            reinterpret_cast<PVOID volatile*>(&g_traceWriterThread), NULL);
+        if (traceThread && !processTerminating)
+            WaitForSingleObject(traceThread, 1500);
+        if (traceThread) CloseHandle(traceThread);
+        if (!processTerminating) {
+            // The writer drains once more on its way out; this catches lines
+            // queued after it stopped and releases the file handle.
+            std::lock_guard<std::mutex> lock(g_traceFileMutex);
+            DrainTraceRingLocked();
+            g_traceFileReleased = true;
+            if (g_traceFile != INVALID_HANDLE_VALUE) {
+                CloseHandle(g_traceFile);
+                g_traceFile = INVALID_HANDLE_VALUE;
+            }
+        }
+
         if (!processTerminating && g_vectoredExceptionHandler) {
             RemoveVectoredExceptionHandler(g_vectoredExceptionHandler);
         }
@@ -572,26 +735,14 @@ namespace Utils {
         vsprintf_s(message, format, args);
         va_end(args);
 
-        std::lock_guard<std::mutex> lock(g_traceFileMutex);
-
-        wchar_t path[MAX_PATH] = {};
-        if (!EnsureTraceSessionInitializedLocked(path, _countof(path))) return;
-
-        HANDLE hFile = CreateFileW(path, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
-            OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-        if (hFile == INVALID_HANDLE_VALUE) return;
-
-        SYSTEMTIME st = {};
-        GetLocalTime(&st);
-
         char line[4096];
-        sprintf_s(line, "[%02u:%02u:%02u.%03u][pid=%lu][tid=%lu] %s\r\n",
-            st.wHour, st.wMinute, st.wSecond, st.wMilliseconds,
-            GetCurrentProcessId(), GetCurrentThreadId(), message);
+        int length = FormatTraceLine(line, sizeof(line), message);
+        if (length <= 0) return;
+        if (TryEnqueueTraceLine(line, (size_t)length)) return;
 
-        DWORD written = 0;
-        WriteFile(hFile, line, (DWORD)strlen(line), &written, NULL);
-        CloseHandle(hFile);
+        std::lock_guard<std::mutex> lock(g_traceFileMutex);
+        DrainTraceRingLocked();
+        WriteTraceBytesLocked(line, (DWORD)length);
     }
 
     BOOL LoadCustomFont(HMODULE hModule) {
@@ -742,6 +893,16 @@ namespace Utils {
         return path;
     }
 
+    // FontHook.cache next to the DLL, shared by the metric-clone and YU-RIS
+    // catalog caches. The directory may not exist yet; writers create it.
+    std::wstring GetCacheDirectory(HMODULE hModule) {
+        wchar_t path[MAX_PATH];
+        GetModuleFileNameW(hModule, path, MAX_PATH);
+        PathRemoveFileSpecW(path);
+        PathAppendW(path, L"FontHook.cache");
+        return path;
+    }
+
     // --- Parse a simple INI from UTF-8 string into key=value map ---
     static std::map<std::string, std::string> ParseIni(const std::string& content) {
         std::map<std::string, std::string> kv;
@@ -799,6 +960,7 @@ namespace Utils {
         out += "EnableDebugLog=" + std::string(boolStr(Config::EnableDebugLog)) + "\r\n";
         out += "DebugSlowMs=" + intStr(Config::DebugSlowMs) + "\r\n";
         out += "DebugTraceSampleLimit=" + intStr(Config::DebugTraceSampleLimit) + "\r\n";
+        out += "DebugTraceBinary=" + std::string(boolStr(Config::DebugTraceBinary)) + "\r\n";
         out += "DebugPickerThreadLogLimit=" + intStr(Config::DebugPickerThreadLogLimit) + "\r\n";
 
         out += "CompatSkipDrawTextA=" + std::string(boolStr(Config::CompatSkipDrawTextA)) + "\r\n";
@@ -974,6 +1136,7 @@ namespace Utils {
         if (Config::DebugSlowMs < 0) Config::DebugSlowMs = 0;
         Config::DebugTraceSampleLimit = getInt("DebugTraceSampleLimit", 0);
         if (Config::DebugTraceSampleLimit < 0) Config::DebugTraceSampleLimit = 0;
+        Config::DebugTraceBinary = getInt("DebugTraceBinary", 0) != 0;
         Config::DebugPickerThreadLogLimit = getInt("DebugPickerThreadLogLimit", 0);
         if (Config::DebugPickerThreadLogLimit < 0) Config::DebugPickerThreadLogLimit = 0;
 
@@ -0,0 +1,418 @@
+// Equivalence check for the native DBCS decode tables against iconv.
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined
+//       -o sfh_dbcs_decode_check tools/dbcs_decode_check/sfh_dbcs_decode_check.cpp
+//   ./sfh_dbcs_decode_check [--seed N] [--strings N] [--bench ROUNDS]
+//
+// The tables are filled from iconv through the same DbcsDecode::Converter
+// interface the DLL fills from MultiByteToWideChar. Every glyph code and a
+// large set of strings are then decoded both ways: through DecodeText, and
+// by handing the bytes to the converter whole, as the DLL's fallback does. A
+// table answer must always match the converter; declining is allowed.
+//
+// --bench skips the checks and times a dialogue-like script per code page:
+// the converter called twice per line (size query, then convert), as
+// DecodeTextAToWide does without a table, against one DecodeText pass. Build
+// with -O2 and without sanitizers for meaningful numbers.
+#include "../../SimpleFontHook/hooks/dbcs_decode_table.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iconv.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+    typedef DbcsDecode::Unit Unit;
+
+    int g_failures = 0;
+    int g_checks = 0;
+
+    void Check(bool condition, const std::string& where, const char* what) {
+        ++g_checks;
+        if (condition) return;
+        ++g_failures;
+        printf("FAIL %s: %s\n", where.c_str(), what);
+    }
+
+    struct CodepageName {
+        unsigned codepage;
+        const char* iconvName;
+    };
+
+    const CodepageName kCodepages[] = {
+        { 932, "CP932" },
+        { 936, "CP936" },
+        { 949, "CP949" },
+        { 950, "CP950" },
+    };
+
+    std::map<unsigned, iconv_t> g_converters;
+
+    iconv_t OpenConverter(unsigned codepage) {
+        auto it = g_converters.find(codepage);
+        if (it != g_converters.end()) return it->second;
+        iconv_t handle = (iconv_t)-1;
+        for (const CodepageName& name : kCodepages) {
+            if (name.codepage == codepage) handle = iconv_open("UTF-16LE", name.iconvName);
+        }
+        g_converters[codepage] = handle;
+        return handle;
+    }
+
+    void CloseConverters() {
+        for (const auto& converter : g_converters) {
+            if (converter.second != (iconv_t)-1) iconv_close(converter.second);
+        }
+        g_converters.clear();
+    }
+
+    // MultiByteToWideChar over iconv: the whole input converts or nothing does.
+    // iconv rejects invalid and truncated sequences where Windows substitutes a
+    // default character, which only moves bytes from the table to the fallback.
+    int IconvConvert(unsigned codepage, const char* bytes, int length, Unit* output, int capacity) {
+        iconv_t handle = OpenConverter(codepage);
+        if (handle == (iconv_t)-1 || length <= 0) return 0;
+        iconv(handle, nullptr, nullptr, nullptr, nullptr);
+
+        std::vector<char> wide((size_t)length * 4 + 8);
+        char* in = const_cast<char*>(bytes);
+        size_t inLeft = (size_t)length;
+        char* out = wide.data();
+        size_t outLeft = wide.size();
+        if (iconv(handle, &in, &inLeft, &out, &outLeft) == (size_t)-1 || inLeft != 0) return 0;
+        if (iconv(handle, nullptr, nullptr, &out, &outLeft) == (size_t)-1) return 0;
+
+        int units = (int)((wide.size() - outLeft) / 2);
+        if (units > capacity) return 0;
+        for (int i = 0; i < units; ++i) {
+            output[i] = (Unit)((uint8_t)wide[(size_t)i * 2] | ((uint8_t)wide[(size_t)i * 2 + 1] << 8));
+        }
+        return units;
+    }
+
+    // IsDBCSLeadByteEx stand-in: a byte that does not convert alone but starts
+    // at least one pair that converts to one unit.
+    bool IconvIsLeadByte(unsigned codepage, uint8_t byte) {
+        static std::map<unsigned, std::vector<bool>> leads;
+        auto it = leads.find(codepage);
+        if (it == leads.end()) {
+            std::vector<bool> table(256, false);
+            for (unsigned b = 0; b < 256; ++b) {
+                char single = (char)b;
+                Unit unit[2] = {};
+                if (IconvConvert(codepage, &single, 1, unit, 2) != 0) continue;
+                for (unsigned trail = 0; trail < 256 && !table[b]; ++trail) {
+                    char pair[2] = { (char)b, (char)trail };
+                    table[b] = IconvConvert(codepage, pair, 2, unit, 2) == 1;
+                }
+            }
+            it = leads.emplace(codepage, table).first;
+        }
+        return it->second[byte];
+    }
+
+    const DbcsDecode::Converter kIconvConverter = { IconvIsLeadByte, IconvConvert };
+
+    // Pages are owned here instead of being published with interlocked
+    // exchanges; the check is single threaded.
+    std::vector<std::unique_ptr<Unit[]>> g_pages;
+
+    const Unit* PageFor(DbcsDecode::Table& table, uint8_t lead) {
+        if (!table.pages[lead]) {
+            g_pages.emplace_back(new Unit[256]());
+            DbcsDecode::FillPage(g_pages.back().get(), table.codepage, lead, kIconvConverter);
+            table.pages[lead] = g_pages.back().get();
+        }
+        return table.pages[lead];
+    }
+
+    // DecodeSingleAnsiGlyphChar's converter path: the code as a big-endian
+    // pair, then byte-swapped, each into a one-unit output.
+    bool ConverterGlyphCode(unsigned codepage, uint32_t input, Unit* output) {
+        if (input <= 0xFF) {
+            char byte = (char)input;
+            return IconvConvert(codepage, &byte, 1, output, 1) == 1;
+        }
+        char pair[2] = { (char)(input >> 8), (char)input };
+        if (IconvConvert(codepage, pair, 2, output, 1) == 1) return true;
+        char reversed[2] = { pair[1], pair[0] };
+        return IconvConvert(codepage, reversed, 2, output, 1) == 1;
+    }
+
+    Unit Unmapped(Unit unit) { return unit; }
+
+    // DecodeDbcsTextSubstituted without substitution: the unit count, or -1
+    // when some byte needs the converter.
+    int TableDecodeText(DbcsDecode::Table& table, const std::vector<uint8_t>& input, std::vector<Unit>& output) {
+        output.assign(input.size(), 0);
+        int written = DbcsDecode::DecodeText(table, input.data(), (int)input.size(), output.data(), PageFor,
+            Unmapped);
+        if (written >= 0) output.resize((size_t)written);
+        return written;
+    }
+
+    bool ConverterDecodeText(unsigned codepage, const std::vector<uint8_t>& input, std::vector<Unit>& output) {
+        output.assign(input.size() + 1, 0);
+        int units = IconvConvert(codepage, (const char*)input.data(), (int)input.size(), output.data(),
+            (int)output.size());
+        if (units <= 0) return false;
+        output.resize((size_t)units);
+        return true;
+    }
+
+    uint32_t g_random = 0x2545F491u;
+
+    uint32_t NextRandom() {
+        g_random ^= g_random << 13;
+        g_random ^= g_random >> 17;
+        g_random ^= g_random << 5;
+        return g_random;
+    }
+
+    void CheckGlyphCodes(const std::string& where, DbcsDecode::Table& table) {
+        int decoded = 0;
+        int rejected = 0;
+        int deferred = 0;
+        bool agrees = true;
+        for (uint32_t input = 0; input <= 0xFFFF; ++input) {
+            Unit fromTable = 0;
+            int known = DbcsDecode::DecodeGlyphCode(table, input, &fromTable, PageFor);
+            if (known < 0) {
+                ++deferred;
+                continue;
+            }
+            Unit fromConverter = 0;
+            bool converted = ConverterGlyphCode(table.codepage, input, &fromConverter);
+            if (known == 0) {
+                ++rejected;
+                if (converted) agrees = false;
+            } else {
+                ++decoded;
+                if (!converted || fromConverter != fromTable) agrees = false;
+            }
+        }
+        Check(agrees, where, "glyph codes decoded by the table match the converter");
+        Check(decoded > 0x3000, where, "the table answers the code page's double-byte repertoire");
+        printf("  glyph codes: decoded=%d rejected=%d deferred=%d\n", decoded, rejected, deferred);
+    }
+
+    void CheckStrings(const std::string& where, DbcsDecode::Table& table, int stringCount) {
+        // Every character the table decodes, as bytes.
+        std::vector<std::vector<uint8_t>> repertoire;
+        for (unsigned b = 0; b < 256; ++b) {
+            if (table.singleKnown[b]) repertoire.push_back(std::vector<uint8_t>(1, (uint8_t)b));
+            if (!table.lead[b]) continue;
+            const Unit* page = PageFor(table, (uint8_t)b);
+            for (unsigned trail = 0; trail < 256; ++trail) {
+                if (page[trail]) repertoire.push_back({ (uint8_t)b, (uint8_t)trail });
+            }
+        }
+
+        bool validAccepted = true;
+        bool validAgrees = true;
+        bool truncatedDeclined = true;
+        for (int n = 0; n < stringCount; ++n) {
+            std::vector<uint8_t> text;
+            size_t characters = 1 + NextRandom() % 48;
+            for (size_t c = 0; c < characters; ++c) {
+                // Half ASCII so lead bytes meet ASCII-range trails and neighbours.
+                const std::vector<uint8_t>& unit = NextRandom() % 2
+                    ? repertoire[NextRandom() % repertoire.size()]
+                    : std::vector<uint8_t>(1, (uint8_t)(0x20 + NextRandom() % 0x5F));
+                text.insert(text.end(), unit.begin(), unit.end());
+            }
+            std::vector<Unit> fromTable;
+            std::vector<Unit> fromConverter;
+            int units = TableDecodeText(table, text, fromTable);
+            bool converted = ConverterDecodeText(table.codepage, text, fromConverter);
+            if (units < 0) validAccepted = false;
+            else if (!converted || fromTable != fromConverter) validAgrees = false;
+
+            for (unsigned b = 0; b < 256; ++b) {
+                if (!table.lead[b]) continue;
+                std::vector<uint8_t> truncated = text;
+                truncated.push_back((uint8_t)b);
+                if (TableDecodeText(table, truncated, fromTable) >= 0) truncatedDeclined = false;
+                break;
+            }
+        }
+        Check(validAccepted, where, "strings of table characters are decoded without the converter");
+        Check(validAgrees, where, "table decoding of valid strings matches the converter");
+        Check(truncatedDeclined, where, "a trailing lead byte is left to the converter");
+
+        // Arbitrary bytes: whatever the table accepts must match the converter.
+        int accepted = 0;
+        bool randomAgrees = true;
+        for (int n = 0; n < stringCount; ++n) {
+            std::vector<uint8_t> text(1 + NextRandom() % 32);
+            for (uint8_t& byte : text) byte = (uint8_t)NextRandom();
+            std::vector<Unit> fromTable;
+            std::vector<Unit> fromConverter;
+            if (TableDecodeText(table, text, fromTable) < 0) continue;
+            ++accepted;
+            if (!ConverterDecodeText(table.codepage, text, fromConverter) || fromTable != fromConverter)
+                randomAgrees = false;
+        }
+        Check(randomAgrees, where, "random bytes accepted by the table match the converter");
+        printf("  strings: repertoire=%zu random-accepted=%d/%d\n", repertoire.size(), accepted, stringCount);
+    }
+
+    double NanosecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Dialogue lines of 8-120 bytes: mostly double-byte characters drawn from
+    // the table's repertoire, with ASCII punctuation, digits and the odd
+    // romanized name in runs long enough for the SSE2 step.
+    std::vector<std::vector<uint8_t>> BuildScript(DbcsDecode::Table& table, size_t lines) {
+        std::vector<std::vector<uint8_t>> pairs;
+        for (unsigned b = 0; b < 256; ++b) {
+            if (!table.lead[b]) continue;
+            const Unit* page = PageFor(table, (uint8_t)b);
+            for (unsigned trail = 0; trail < 256; ++trail) {
+                if (page[trail]) pairs.push_back({ (uint8_t)b, (uint8_t)trail });
+            }
+        }
+        // A few thousand characters dominate real scripts; favour the low part of
+        // the repertoire so the pages they touch stay warm.
+        size_t common = std::min<size_t>(pairs.size(), 3000);
+
+        std::vector<std::vector<uint8_t>> script(lines);
+        for (std::vector<uint8_t>& line : script) {
+            size_t target = 8 + NextRandom() % 113;
+            while (line.size() < target) {
+                uint32_t pick = NextRandom() % 100;
+                if (pick < 80) {
+                    const std::vector<uint8_t>& pair = pairs[NextRandom() % (pick < 70 ? common : pairs.size())];
+                    line.insert(line.end(), pair.begin(), pair.end());
+                } else if (pick < 95) {
+                    line.push_back((uint8_t)(0x21 + NextRandom() % 0x5E));
+                } else {
+                    for (int n = 0; n < 18; ++n) line.push_back((uint8_t)('a' + NextRandom() % 26));
+                }
+            }
+        }
+        return script;
+    }
+
+    void BenchmarkCodepage(const CodepageName& name, int rounds) {
+        printf("%s\n", name.iconvName);
+        if (OpenConverter(name.codepage) == (iconv_t)-1) {
+            printf("  skipped: iconv has no %s\n", name.iconvName);
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<DbcsDecode::Table> table(new DbcsDecode::Table());
+        DbcsDecode::FillTable(*table, name.codepage, kIconvConverter);
+        for (unsigned b = 0; b < 256; ++b) {
+            if (table->lead[b]) PageFor(*table, (uint8_t)b);
+        }
+        double fillNs = NanosecondsSince(start);
+
+        std::vector<std::vector<uint8_t>> script = BuildScript(*table, 4096);
+        size_t bytes = 0;
+        for (const std::vector<uint8_t>& line : script) bytes += line.size();
+        std::vector<Unit> output(4 * 121);
+
+        // Converter path: size query then convert, as the DLL's fallback does.
+        uint64_t checksum = 0;
+        start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (const std::vector<uint8_t>& line : script) {
+                const char* text = (const char*)line.data();
+                int size = IconvConvert(name.codepage, text, (int)line.size(), output.data(), (int)output.size());
+                int units = IconvConvert(name.codepage, text, (int)line.size(), output.data(), size);
+                checksum += (uint64_t)units + output[0];
+            }
+        }
+        double converterNs = NanosecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        uint64_t tableChecksum = 0;
+        int declined = 0;
+        for (int round = 0; round < rounds; ++round) {
+            for (const std::vector<uint8_t>& line : script) {
+                int units = DbcsDecode::DecodeText(*table, line.data(), (int)line.size(), output.data(), PageFor,
+                    Unmapped);
+                if (units < 0) ++declined;
+                tableChecksum += (uint64_t)units + output[0];
+            }
+        }
+        double tableNs = NanosecondsSince(start);
+
+        double totalBytes = (double)bytes * rounds;
+        double totalLines = (double)script.size() * rounds;
+        printf("  fill %.2f ms  lines=%zu bytes=%zu  converter %.0f ns/line %.2f ns/byte  table %.0f ns/line "
+            "%.2f ns/byte  %.1fx%s\n",
+            fillNs / 1e6, script.size(), bytes, converterNs / totalLines, converterNs / totalBytes,
+            tableNs / totalLines, tableNs / totalBytes, converterNs / tableNs,
+            declined || checksum != tableChecksum ? "  MISMATCH" : "");
+        Check(!declined && checksum == tableChecksum, name.iconvName, "the table decodes the script like the converter");
+    }
+
+    void CheckCodepage(const CodepageName& name, int stringCount) {
+        std::string where = name.iconvName;
+        printf("%s\n", name.iconvName);
+        if (OpenConverter(name.codepage) == (iconv_t)-1) {
+            printf("  skipped: iconv has no %s\n", name.iconvName);
+            return;
+        }
+
+        std::unique_ptr<DbcsDecode::Table> table(new DbcsDecode::Table());
+        DbcsDecode::FillTable(*table, name.codepage, kIconvConverter);
+        int leads = 0;
+        for (unsigned b = 0; b < 256; ++b) leads += table->lead[b] ? 1 : 0;
+        Check(table->asciiIdentity, where, "ASCII decodes to itself");
+        Check(leads >= 30, where, "the code page has lead bytes");
+        for (unsigned b = 0; b < 256; ++b) {
+            if (!table->lead[b]) continue;
+            char single = (char)b;
+            Unit unit = 0;
+            Check(IconvConvert(name.codepage, &single, 1, &unit, 1) == 0, where, "a lead byte does not convert alone");
+            break;
+        }
+
+        CheckGlyphCodes(where, *table);
+        CheckStrings(where, *table, stringCount);
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int stringCount = 20000;
+    int benchRounds = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--seed") == 0) {
+            g_random = (uint32_t)strtoul(argv[i + 1], nullptr, 0);
+            if (!g_random) g_random = 1;
+        } else if (strcmp(argv[i], "--strings") == 0) {
+            stringCount = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchRounds = atoi(argv[i + 1]);
+            if (benchRounds < 1) benchRounds = 1;
+        } else {
+            fprintf(stderr, "usage: sfh_dbcs_decode_check [--seed N] [--strings N] [--bench ROUNDS]\n");
+            return 2;
+        }
+    }
+    if (argc % 2 == 0) {
+        fprintf(stderr, "usage: sfh_dbcs_decode_check [--seed N] [--strings N] [--bench ROUNDS]\n");
+        return 2;
+    }
+
+    for (const CodepageName& name : kCodepages) {
+        if (benchRounds) BenchmarkCodepage(name, benchRounds);
+        else CheckCodepage(name, stringCount);
+    }
+    CloseConverters();
+    printf("%d checks, %d failed\n", g_checks, g_failures);
+    return g_failures ? 1 : 0;
+}
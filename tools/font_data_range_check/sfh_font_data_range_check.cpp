@@ -0,0 +1,501 @@
+// Equivalence check for the patch-once GetFontData cache on real fonts.
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined -I tools/win32_compat
+//       -o sfh_font_data_range_check tools/font_data_range_check/sfh_font_data_range_check.cpp
+//       SimpleFontHook/font/font_patcher.cpp
+//   ./sfh_font_data_range_check [--bench ROUNDS] font.ttf [font.otf ...]
+//
+// A model of GDI's GetFontData answers reads from the font file. For every table
+// and a grid of offsets and lengths, the cached path (read the whole table once,
+// patch it at offset 0, serve the range with FontDataRange::Serve) must return
+// the same count and bytes as the uncached path (read the range, patch the
+// returned bytes at their offset). Table 0 is compared with the same range of a
+// whole-font read, since the uncached path only patches reads that start at 0.
+// The range and field code comes from the DLL headers unchanged; only the
+// Config glue around it is modelled here.
+//
+// --bench times what a FreeType-style reader costs on table 0: the whole font
+// read in 64 KB chunks and in one full-size request, each repeated ROUNDS
+// times, through both paths. The uncached path reads the file with pread, so
+// every request pays a kernel transition and copy as GetFontData does. Build
+// with -O2 for meaningful numbers.
+#include "../../SimpleFontHook/font/font_patcher.h"
+#include "../../SimpleFontHook/hooks/font_data_range.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+    const uint32_t kGdiError = 0xFFFFFFFFu;
+
+    // kFontDataCacheMaxTable in the x86 build.
+    const size_t kX86MaxTable = 24u * 1024 * 1024;
+
+    int g_failures = 0;
+    int g_checks = 0;
+
+    void Check(bool condition, const std::string& where, const char* what) {
+        ++g_checks;
+        if (condition) return;
+        ++g_failures;
+        printf("FAIL %s: %s\n", where.c_str(), what);
+    }
+
+    uint16_t U16(const uint8_t* p) { return (uint16_t)((p[0] << 8) | p[1]); }
+    uint32_t U32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]; }
+
+    // File order 'OS/2' (0x4F532F32) to GDI's dwTable order (0x322F534F).
+    uint32_t GdiTag(uint32_t fileTag) {
+        return (fileTag >> 24) | ((fileTag >> 8) & 0xFF00) | ((fileTag << 8) & 0xFF0000) | (fileTag << 24);
+    }
+
+    std::string TagName(uint32_t gdiTag) {
+        if (gdiTag == 0) return "<font>";
+        std::string name;
+        for (int i = 0; i < 4; ++i) name.push_back((char)((gdiTag >> (i * 8)) & 0xFF));
+        return name;
+    }
+
+    uint32_t Checksum(const uint8_t* data, size_t length) {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < length; i += 4) {
+            uint32_t word = 0;
+            for (size_t k = 0; k < 4; ++k) word = (word << 8) | (i + k < length ? data[i + k] : 0);
+            sum += word;
+        }
+        return sum;
+    }
+
+    struct TableSpan {
+        uint32_t fileTag = 0;
+        size_t offset = 0;
+        size_t length = 0;
+    };
+
+    // GetFontData over one standalone sfnt: table 0 is the whole file, any
+    // other table is its directory slice. Reads at or past the end fail.
+    struct GdiFontModel {
+        std::vector<uint8_t> file;
+        std::map<uint32_t, TableSpan> tables;   // keyed by GDI tag
+
+        bool Parse() {
+            if (file.size() < 12) return false;
+            uint32_t version = U32(file.data());
+            if (version != 0x00010000 && version != 0x4F54544F && version != 0x74727565) return false;
+            uint16_t count = U16(file.data() + 4);
+            if (12 + (size_t)count * 16 > file.size()) return false;
+            for (uint16_t i = 0; i < count; ++i) {
+                const uint8_t* record = file.data() + 12 + (size_t)i * 16;
+                TableSpan span;
+                span.fileTag = U32(record);
+                span.offset = U32(record + 8);
+                span.length = U32(record + 12);
+                if (span.offset > file.size() || span.length > file.size() - span.offset) return false;
+                tables[GdiTag(span.fileTag)] = span;
+            }
+            return true;
+        }
+
+        bool Span(uint32_t table, const uint8_t** data, size_t* size) const {
+            if (table == 0) {
+                *data = file.data();
+                *size = file.size();
+                return true;
+            }
+            auto it = tables.find(table);
+            if (it == tables.end()) return false;
+            *data = file.data() + it->second.offset;
+            *size = it->second.length;
+            return true;
+        }
+
+        uint32_t GetFontData(uint32_t table, uint32_t offset, void* buffer, uint32_t cj) const {
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+            if (!Span(table, &data, &size)) return kGdiError;
+            if (!buffer || cj == 0) return offset < size ? (uint32_t)(size - offset) : kGdiError;
+            if (offset >= size) return kGdiError;
+            uint32_t copied = (uint32_t)std::min<size_t>(size - offset, cj);
+            memcpy(buffer, data + offset, copied);
+            return copied;
+        }
+
+        int UnitsPerEm() const {
+            uint8_t upm[2] = {};
+            if (GetFontData(FontDataRange::kTableHead, 18, upm, 2) != 2) return 1000;
+            int value = U16(upm);
+            return value > 0 ? value : 1000;
+        }
+    };
+
+    // The Config fields PatchReturnedFontData reads.
+    struct PatchConfig {
+        const char* name;
+        bool codepageSpoof;
+        DWORD spoofCharset;
+        bool verticalMetrics;
+        int ascentPermille;
+        int descentPermille;
+        bool enableLineSpacing;
+        int lineSpacing;
+    };
+
+    int Clamp(int value, int lo, int hi) { return std::max(lo, std::min(hi, value)); }
+
+    int ScalePermille(int base, int permille) {
+        long long value = (long long)base * (long long)permille;
+        if (value >= 0) return (int)((value + 500) / 1000);
+        return (int)((value - 500) / 1000);
+    }
+
+    // Mirrors PatchReturnedFontData and its per-table helpers in the DLL.
+    void PatchReturned(const GdiFontModel& font, const PatchConfig& config, uint32_t table, uint32_t offset,
+        uint8_t* buffer, uint32_t bytesCopied) {
+        if (!buffer || bytesCopied == 0) return;
+        bool hasLineSpacing = config.enableLineSpacing && config.lineSpacing != 0;
+        if (table == 0 && offset == 0) {
+            if (config.codepageSpoof)
+                FontPatcher::PatchOS2CodePageRangeForCharset(buffer, bytesCopied, config.spoofCharset);
+            if (config.verticalMetrics) {
+                FontPatcher::PatchVerticalMetrics(buffer, bytesCopied, config.ascentPermille,
+                    config.descentPermille, config.enableLineSpacing ? config.lineSpacing : 0);
+            }
+            return;
+        }
+        if (config.codepageSpoof && table == FontDataRange::kTableOS2) {
+            FontDataRange::PatchCodePageRange(table, offset, buffer, bytesCopied,
+                FontPatcher::CodePageRangeBitForCharset(config.spoofCharset));
+        }
+        if (config.verticalMetrics && (table == FontDataRange::kTableHhea || table == FontDataRange::kTableOS2)) {
+            int em = font.UnitsPerEm();
+            int ascent = Clamp(ScalePermille(em, Clamp(config.ascentPermille, 100, 2000)), -32768, 32767);
+            int descent = Clamp(ScalePermille(em, Clamp(config.descentPermille, -2000, -1)), -32768, 32767);
+            int lineGap = Clamp(ScalePermille(em, hasLineSpacing ? Clamp(config.lineSpacing, -2000, 2000) : 0),
+                -32768, 32767);
+            FontDataRange::PatchVerticalMetricFields(table, offset, buffer, bytesCopied, ascent, descent, lineGap);
+        }
+    }
+
+    // What LoadFontDataTable stores: the whole table, patched once at offset 0.
+    bool LoadPatchedTable(const GdiFontModel& font, const PatchConfig& config, uint32_t table,
+        std::vector<uint8_t>& bytes) {
+        uint32_t size = font.GetFontData(table, 0, nullptr, 0);
+        if (size == kGdiError || size == 0) return false;
+        bytes.assign(size, 0);
+        if (font.GetFontData(table, 0, bytes.data(), size) != size) return false;
+        PatchReturned(font, config, table, 0, bytes.data(), size);
+        return true;
+    }
+
+    const size_t kGuard = 16;
+    const uint8_t kCanary = 0xA5;
+
+    struct Read {
+        uint32_t result = kGdiError;
+        bool served = true;         // false when the cache declined and GDI answered
+        std::vector<uint8_t> bytes; // cj bytes plus the guard
+    };
+
+    // The cache path of TryGetCachedFontData: serve from the patched table, or
+    // fall through to GDI plus the per-call patch when Serve declines.
+    Read CachedRead(const GdiFontModel& font, const PatchConfig& config, uint32_t table,
+        const std::vector<uint8_t>& patched, uint32_t offset, uint32_t cj) {
+        Read read;
+        read.bytes.assign((size_t)cj + kGuard, kCanary);
+        uint8_t* buffer = cj ? read.bytes.data() : nullptr;
+        uint32_t result = 0;
+        if (FontDataRange::Serve(patched.data(), patched.size(), offset, buffer, cj, &result)) {
+            read.result = result;
+            return read;
+        }
+        read.served = false;
+        read.result = font.GetFontData(table, offset, buffer, cj);
+        if (read.result != kGdiError && buffer) PatchReturned(font, config, table, offset, buffer, std::min(read.result, cj));
+        return read;
+    }
+
+    Read UncachedRead(const GdiFontModel& font, const PatchConfig& config, uint32_t table, uint32_t offset,
+        uint32_t cj) {
+        Read read;
+        read.bytes.assign((size_t)cj + kGuard, kCanary);
+        uint8_t* buffer = cj ? read.bytes.data() : nullptr;
+        read.result = font.GetFontData(table, offset, buffer, cj);
+        if (read.result != kGdiError && buffer) PatchReturned(font, config, table, offset, buffer, std::min(read.result, cj));
+        return read;
+    }
+
+    bool GuardIntact(const Read& read, uint32_t cj) {
+        for (size_t i = cj; i < read.bytes.size(); ++i) {
+            if (read.bytes[i] != kCanary) return false;
+        }
+        return true;
+    }
+
+    // Offsets around each patched field and the table edges, crossed with
+    // lengths that split those fields or run past the end.
+    void CollectRanges(size_t size, std::vector<uint32_t>& offsets, std::vector<uint32_t>& lengths) {
+        static const uint32_t kFieldEdges[] = { 3, 4, 5, 6, 7, 8, 9, 10, 18, 19, 67, 68, 69, 70, 71, 72, 73, 74,
+            75, 76, 77, 78, 79, 80, 81, 82 };
+        offsets.assign(kFieldEdges, kFieldEdges + sizeof(kFieldEdges) / sizeof(kFieldEdges[0]));
+        offsets.push_back(0);
+        offsets.push_back(1);
+        uint32_t size32 = (uint32_t)size;
+        if (size32 > 1) offsets.push_back(size32 - 1);
+        offsets.push_back(size32);
+        offsets.push_back(size32 + 1);
+        offsets.push_back(size32 / 2);
+        offsets.push_back(0xFFFFFFF0u);
+
+        lengths = { 1, 2, 3, 4, 5, 7, 11, 64, 4096, size32, size32 + 13 };
+        if (size32 > 1) lengths.push_back(size32 - 1);
+    }
+
+    void CheckTable(const std::string& name, const GdiFontModel& font, const PatchConfig& config, uint32_t table) {
+        std::string where = name + " " + config.name + " " + TagName(table);
+        std::vector<uint8_t> patched;
+        if (!LoadPatchedTable(font, config, table, patched)) {
+            Check(false, where, "table did not load");
+            return;
+        }
+
+        uint32_t sizeResult = 0;
+        Check(FontDataRange::Serve(patched.data(), patched.size(), 0, nullptr, 0, &sizeResult) &&
+            sizeResult == patched.size(), where, "size query at offset 0 is served with the table size");
+        Check(!FontDataRange::Serve(patched.data(), patched.size(), 1, nullptr, 0, &sizeResult),
+            where, "size query past the start is left to GDI");
+        Check(FontDataRange::Serve(patched.data(), patched.size(), 0, patched.data(), 0, &sizeResult) &&
+            sizeResult == patched.size(), where, "zero-length read is a size query");
+
+        Read wholeRead = UncachedRead(font, config, table, 0, (uint32_t)patched.size());
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> lengths;
+        CollectRanges(patched.size(), offsets, lengths);
+        bool sameResults = true;
+        bool sameBytes = true;
+        bool guards = true;
+        bool declinedPastEnd = true;
+        bool servedInside = true;
+        for (uint32_t offset : offsets) {
+            for (uint32_t cj : lengths) {
+                if (cj == 0) continue;
+                Read cached = CachedRead(font, config, table, patched, offset, cj);
+                Read uncached = UncachedRead(font, config, table, offset, cj);
+                guards = guards && GuardIntact(cached, cj);
+                if (offset >= patched.size()) declinedPastEnd = declinedPastEnd && !cached.served;
+                else servedInside = servedInside && cached.served;
+                if (cached.result != uncached.result) {
+                    sameResults = false;
+                    continue;
+                }
+                if (cached.result == kGdiError) continue;
+                // Whole-font patches parse the sfnt in the returned buffer, so the
+                // uncached path only patches a table 0 read that starts at 0. The
+                // cache serves every range of table 0 from one whole-font read.
+                const uint8_t* expected = table == 0
+                    ? wholeRead.bytes.data() + offset
+                    : uncached.bytes.data();
+                if (!std::equal(cached.bytes.begin(), cached.bytes.begin() + cached.result, expected))
+                    sameBytes = false;
+            }
+        }
+        Check(sameResults, where, "cached and uncached reads return the same count");
+        Check(sameBytes, where, "cached and uncached reads return the same bytes");
+        Check(guards, where, "served reads stay inside the caller's buffer");
+        Check(declinedPastEnd, where, "reads at or past the end are left to GDI");
+        Check(servedInside, where, "reads inside the table are served from the cache");
+
+        // FreeType-style sequential reads reassemble the stored table.
+        static const uint32_t kChunks[] = { 1000, 16384 };
+        for (uint32_t chunk : kChunks) {
+            std::vector<uint8_t> assembled;
+            uint32_t offset = 0;
+            bool ok = true;
+            while (offset < patched.size()) {
+                Read read = CachedRead(font, config, table, patched, offset, chunk);
+                if (!read.served || read.result == 0 || read.result == kGdiError) {
+                    ok = false;
+                    break;
+                }
+                assembled.insert(assembled.end(), read.bytes.begin(), read.bytes.begin() + read.result);
+                offset += read.result;
+            }
+            Check(ok && assembled == patched, where, "chunked reads reassemble the patched table");
+        }
+    }
+
+    // A face opened from table 0 and one that reads tables one by one must see
+    // the same patched metric and code page fields.
+    void CheckWholeFontAgreesWithTables(const std::string& name, const GdiFontModel& font,
+        const PatchConfig& config) {
+        std::string where = name + " " + config.name;
+        std::vector<uint8_t> whole;
+        if (!LoadPatchedTable(font, config, 0, whole)) {
+            Check(false, where, "whole font did not load");
+            return;
+        }
+        static const uint32_t kPatchedTables[] = { FontDataRange::kTableOS2, FontDataRange::kTableHhea };
+        for (uint32_t table : kPatchedTables) {
+            auto it = font.tables.find(table);
+            if (it == font.tables.end()) continue;
+            std::vector<uint8_t> single;
+            if (!LoadPatchedTable(font, config, table, single)) continue;
+            const uint8_t* inWhole = whole.data() + it->second.offset;
+            Check(std::equal(single.begin(), single.end(), inWhole),
+                where + " " + TagName(table), "whole-font and single-table reads agree");
+
+            uint32_t stored = 0;
+            for (uint16_t i = 0; i < U16(whole.data() + 4); ++i) {
+                const uint8_t* record = whole.data() + 12 + (size_t)i * 16;
+                if (U32(record) == it->second.fileTag) stored = U32(record + 4);
+            }
+            Check(stored == Checksum(inWhole, it->second.length),
+                where + " " + TagName(table), "patched table checksum is current");
+        }
+        Check(Checksum(whole.data(), whole.size()) == 0xB1B0AFBAu, where, "patched font checksum adjustment holds");
+    }
+
+    const PatchConfig kConfigs[] = {
+        { "plain", false, 0, false, 0, 0, false, 0 },
+        { "spoof-sjis", true, SHIFTJIS_CHARSET, false, 0, 0, false, 0 },
+        { "spoof-gb2312", true, GB2312_CHARSET, false, 0, 0, false, 0 },
+        { "metrics", false, 0, true, 880, -120, false, 0 },
+        { "metrics-gap", true, CHINESEBIG5_CHARSET, true, 1100, -300, true, 150 },
+        { "metrics-clamped", true, HANGUL_CHARSET, true, 5000, 5000, true, -5000 },
+    };
+
+    bool ReadFile(const char* path, std::string& out) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input) return false;
+        out.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    void CheckFont(const char* path) {
+        std::string raw;
+        if (!ReadFile(path, raw)) {
+            Check(false, path, "cannot open file");
+            return;
+        }
+        printf("%s\n", path);
+        GdiFontModel font;
+        font.file.assign(raw.begin(), raw.end());
+        if (!font.Parse()) {
+            printf("  skipped: not a standalone sfnt\n");
+            return;
+        }
+
+        std::string name = path;
+        for (const PatchConfig& config : kConfigs) {
+            CheckTable(name, font, config, 0);
+            for (const auto& table : font.tables) CheckTable(name, font, config, table.first);
+            CheckWholeFontAgreesWithTables(name, font, config);
+        }
+
+        // Tables the x86 cache leaves with GDI (see kFontDataCacheMaxTable).
+        if (font.file.size() > kX86MaxTable)
+            printf("  note: whole font exceeds the x86 per-table limit and is not cached there\n");
+    }
+
+    double MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Reads all of table 0 in `chunk`-sized requests; a chunk as large as the
+    // font is the full-size fetch. Returns microseconds per pass.
+    template <typename ReadChunk>
+    double TimeWholeFontReads(size_t size, uint32_t chunk, int rounds, std::vector<uint8_t>& buffer,
+        ReadChunk readChunk) {
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (size_t offset = 0; offset < size;) {
+                uint32_t got = readChunk((uint32_t)offset, buffer.data(), chunk);
+                if (got == 0 || got == kGdiError) break;
+                offset += got;
+            }
+        }
+        return MicrosecondsSince(start) / rounds;
+    }
+
+    // Cached: one LoadPatchedTable, then FontDataRange::Serve per request.
+    // Uncached: pread plus PatchReturned per request, as newGetFontData did
+    // before the cache and still does for tables above the per-table limit.
+    void BenchmarkFont(const char* path, int rounds) {
+        std::string raw;
+        GdiFontModel font;
+        if (!ReadFile(path, raw)) return;
+        font.file.assign(raw.begin(), raw.end());
+        if (!font.Parse()) {
+            printf("%s\n  skipped: not a standalone sfnt\n", path);
+            return;
+        }
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return;
+
+        const PatchConfig& config = kConfigs[4];
+        size_t size = font.file.size();
+        std::vector<uint8_t> buffer(size);
+        auto fillStart = std::chrono::steady_clock::now();
+        std::vector<uint8_t> patched;
+        if (!LoadPatchedTable(font, config, 0, patched)) {
+            close(fd);
+            return;
+        }
+        double fillUs = MicrosecondsSince(fillStart);
+
+        auto uncached = [&](uint32_t offset, uint8_t* out, uint32_t cj) {
+            if (offset >= size) return kGdiError;
+            ssize_t got = pread(fd, out, std::min<size_t>(cj, size - offset), (off_t)offset);
+            if (got <= 0) return kGdiError;
+            PatchReturned(font, config, 0, offset, out, (uint32_t)got);
+            return (uint32_t)got;
+        };
+        auto cached = [&](uint32_t offset, uint8_t* out, uint32_t cj) {
+            uint32_t got = 0;
+            return FontDataRange::Serve(patched.data(), patched.size(), offset, out, cj, &got) ? got : kGdiError;
+        };
+
+        printf("%s (%.1f MB, x86 %s, fill %.0f us)\n", path, size / 1048576.0,
+            size <= kX86MaxTable ? "cached" : "uncached", fillUs);
+        const uint32_t chunks[] = { 65536, (uint32_t)size };
+        for (uint32_t chunk : chunks) {
+            double before = TimeWholeFontReads(size, chunk, rounds, buffer, uncached);
+            double after = TimeWholeFontReads(size, chunk, rounds, buffer, cached);
+            printf("  %-9s uncached %9.1f us  cached %9.1f us  %6.2fx\n", chunk == size ? "full" : "64KB",
+                before, after, before / after);
+        }
+        close(fd);
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int benchRounds = 0;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0) {
+        benchRounds = atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc || (first == 3 && benchRounds <= 0)) {
+        fprintf(stderr, "usage: sfh_font_data_range_check [--bench ROUNDS] font.ttf [font.otf ...]\n");
+        return 2;
+    }
+    if (benchRounds) {
+        for (int i = first; i < argc; ++i) BenchmarkFont(argv[i], benchRounds);
+        return 0;
+    }
+    for (int i = first; i < argc; ++i) CheckFont(argv[i]);
+    printf("%d checks, %d failed\n", g_checks, g_failures);
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,821 @@
+// Round-trip check for FontPatcher::SubsetFont on real fonts.
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined -I tools/win32_compat
+//       -o sfh_font_subset_check tools/font_subset_check/sfh_font_subset_check.cpp
+//       SimpleFontHook/font/font_patcher.cpp
+//   ./sfh_font_subset_check [--text script.txt] [--bench N] font.ttf [font.otf ...]
+//
+// Every subset is parsed again with an independent reader: the table directory,
+// cmap, glyph count, metrics and each kept outline are compared with the source
+// font. Damaged inputs only have to be rejected or produce a well-formed font;
+// running under the sanitizers catches out-of-bounds reads on those paths.
+// SfntTableBuilder output is checked the same way, including fonts whose table
+// directory is not sorted by tag. --bench N times N applies of each table edit
+// against the append-and-resum path it replaced (build with -O2 for numbers).
+#include "../../SimpleFontHook/font/font_patcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+    int g_failures = 0;
+    int g_checks = 0;
+
+    void Check(bool condition, const std::string& font, const char* what) {
+        ++g_checks;
+        if (condition) return;
+        ++g_failures;
+        printf("FAIL %s: %s\n", font.c_str(), what);
+    }
+
+    uint16_t U16(const uint8_t* p) { return (uint16_t)((p[0] << 8) | p[1]); }
+    uint32_t U32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]; }
+    void PutU16(std::vector<uint8_t>& out, uint16_t v) { out.push_back((uint8_t)(v >> 8)); out.push_back((uint8_t)v); }
+    void PutU32(std::vector<uint8_t>& out, uint32_t v) { PutU16(out, (uint16_t)(v >> 16)); PutU16(out, (uint16_t)v); }
+
+    uint32_t Tag(const char* s) { return ((uint32_t)s[0] << 24) | ((uint32_t)s[1] << 16) | ((uint32_t)s[2] << 8) | (uint8_t)s[3]; }
+
+    uint32_t Checksum(const uint8_t* data, size_t length) {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < length; i += 4) {
+            uint32_t word = 0;
+            for (size_t k = 0; k < 4; ++k) word = (word << 8) | (i + k < length ? data[i + k] : 0);
+            sum += word;
+        }
+        return sum;
+    }
+
+    struct TableSpan {
+        uint32_t checksum = 0;
+        size_t offset = 0;
+        size_t length = 0;
+    };
+
+    // Independent view of a standalone sfnt. Construction fails on any record
+    // that would read outside the file.
+    struct Sfnt {
+        const std::vector<uint8_t>* bytes = nullptr;
+        uint32_t version = 0;
+        std::map<uint32_t, TableSpan> tables;
+        std::vector<uint32_t> order;
+
+        bool Parse(const std::vector<uint8_t>& data) {
+            bytes = &data;
+            tables.clear();
+            order.clear();
+            if (data.size() < 12) return false;
+            version = U32(data.data());
+            uint16_t count = U16(data.data() + 4);
+            if (12 + (size_t)count * 16 > data.size()) return false;
+            for (uint16_t i = 0; i < count; ++i) {
+                const uint8_t* record = data.data() + 12 + (size_t)i * 16;
+                TableSpan span;
+                span.checksum = U32(record + 4);
+                span.offset = U32(record + 8);
+                span.length = U32(record + 12);
+                if (span.offset > data.size() || span.length > data.size() - span.offset) return false;
+                tables[U32(record)] = span;
+                order.push_back(U32(record));
+            }
+            return true;
+        }
+
+        const uint8_t* Find(const char* tag, size_t* length) const {
+            auto it = tables.find(Tag(tag));
+            if (it == tables.end()) {
+                *length = 0;
+                return nullptr;
+            }
+            *length = it->second.length;
+            return bytes->data() + it->second.offset;
+        }
+
+        std::vector<uint8_t> Copy(const char* tag) const {
+            size_t length = 0;
+            const uint8_t* data = Find(tag, &length);
+            return data ? std::vector<uint8_t>(data, data + length) : std::vector<uint8_t>();
+        }
+
+        uint16_t GlyphCount() const {
+            size_t length = 0;
+            const uint8_t* maxp = Find("maxp", &length);
+            return maxp && length >= 6 ? U16(maxp + 4) : 0;
+        }
+    };
+
+    // Unicode mapping from the best Windows/Unicode subtable, formats 4 and 12.
+    std::map<uint32_t, uint16_t> ReadCmap(const Sfnt& font) {
+        std::map<uint32_t, uint16_t> map;
+        size_t length = 0;
+        const uint8_t* cmap = font.Find("cmap", &length);
+        if (!cmap || length < 4) return map;
+
+        size_t best = 0;
+        int bestRank = 0;
+        uint16_t count = U16(cmap + 2);
+        for (uint16_t i = 0; i < count && 4 + (size_t)i * 8 + 8 <= length; ++i) {
+            const uint8_t* record = cmap + 4 + (size_t)i * 8;
+            uint16_t platform = U16(record);
+            uint16_t encoding = U16(record + 2);
+            size_t offset = U32(record + 4);
+            if (offset + 2 > length) continue;
+            uint16_t format = U16(cmap + offset);
+            int rank = 0;
+            if (format == 12 && (platform == 3 || platform == 0)) rank = 3;
+            else if (format == 4 && platform == 3 && encoding == 1) rank = 2;
+            else if (format == 4 && platform == 0) rank = 1;
+            if (rank > bestRank) {
+                bestRank = rank;
+                best = offset;
+            }
+        }
+        if (!bestRank) return map;
+
+        const uint8_t* sub = cmap + best;
+        size_t available = length - best;
+        if (U16(sub) == 12) {
+            if (available < 16) return map;
+            uint32_t groups = U32(sub + 12);
+            for (uint32_t g = 0; g < groups && 16 + (size_t)g * 12 + 12 <= available; ++g) {
+                const uint8_t* group = sub + 16 + (size_t)g * 12;
+                uint32_t start = U32(group);
+                uint32_t end = U32(group + 4);
+                uint32_t glyph = U32(group + 8);
+                for (uint32_t cp = start; cp <= end && cp <= 0x10FFFF; ++cp) {
+                    uint32_t mapped = glyph + (cp - start);
+                    if (mapped && mapped <= 0xFFFF) map[cp] = (uint16_t)mapped;
+                }
+            }
+            return map;
+        }
+
+        if (available < 14) return map;
+        uint16_t segX2 = U16(sub + 6);
+        size_t ends = 14;
+        size_t starts = ends + segX2 + 2;
+        size_t deltas = starts + segX2;
+        size_t rangeOffsets = deltas + segX2;
+        if (rangeOffsets + segX2 > available) return map;
+        for (uint16_t s = 0; s < segX2 / 2; ++s) {
+            uint16_t end = U16(sub + ends + s * 2);
+            uint16_t start = U16(sub + starts + s * 2);
+            uint16_t delta = U16(sub + deltas + s * 2);
+            uint16_t rangeOffset = U16(sub + rangeOffsets + s * 2);
+            for (uint32_t cp = start; cp <= end && cp != 0xFFFF; ++cp) {
+                uint16_t glyph = 0;
+                if (rangeOffset == 0) {
+                    glyph = (uint16_t)(cp + delta);
+                } else {
+                    size_t at = rangeOffsets + s * 2 + rangeOffset + (cp - start) * 2;
+                    if (at + 2 > available) continue;
+                    glyph = U16(sub + at);
+                    if (glyph) glyph = (uint16_t)(glyph + delta);
+                }
+                if (glyph) map[cp] = glyph;
+            }
+        }
+        return map;
+    }
+
+    // Raw outline bytes per glyph id: glyf entries, or CFF CharStrings.
+    struct Outlines {
+        bool cff = false;
+        std::vector<std::vector<uint8_t>> glyphs;
+    };
+
+    bool ReadGlyf(const Sfnt& font, Outlines& out) {
+        size_t headLength = 0, locaLength = 0, glyfLength = 0;
+        const uint8_t* head = font.Find("head", &headLength);
+        const uint8_t* loca = font.Find("loca", &locaLength);
+        const uint8_t* glyf = font.Find("glyf", &glyfLength);
+        if (!head || headLength < 54 || !loca || !glyf) return false;
+        bool longLoca = U16(head + 50) != 0;
+        size_t count = font.GlyphCount();
+        if ((count + 1) * (longLoca ? 4 : 2) > locaLength) return false;
+        out.glyphs.assign(count, std::vector<uint8_t>());
+        for (size_t g = 0; g < count; ++g) {
+            size_t start = longLoca ? U32(loca + g * 4) : (size_t)U16(loca + g * 2) * 2;
+            size_t end = longLoca ? U32(loca + g * 4 + 4) : (size_t)U16(loca + g * 2 + 2) * 2;
+            if (end < start || end > glyfLength) return false;
+            out.glyphs[g].assign(glyf + start, glyf + end);
+        }
+        return true;
+    }
+
+    bool ReadCffIndex(const uint8_t* cff, size_t length, size_t pos, std::vector<std::pair<size_t, size_t>>& items, size_t* end) {
+        items.clear();
+        if (pos + 2 > length) return false;
+        uint16_t count = U16(cff + pos);
+        if (count == 0) {
+            *end = pos + 2;
+            return true;
+        }
+        if (pos + 3 > length) return false;
+        uint8_t offSize = cff[pos + 2];
+        if (offSize < 1 || offSize > 4) return false;
+        size_t offsets = pos + 3;
+        size_t base = offsets + ((size_t)count + 1) * offSize - 1;
+        if (base >= length) return false;
+        auto offsetAt = [&](size_t i) {
+            size_t value = 0;
+            for (uint8_t k = 0; k < offSize; ++k) value = (value << 8) | cff[offsets + i * offSize + k];
+            return value;
+        };
+        for (size_t i = 0; i < count; ++i) {
+            size_t start = base + offsetAt(i);
+            size_t stop = base + offsetAt(i + 1);
+            if (stop < start || stop > length) return false;
+            items.push_back(std::make_pair(start, stop));
+        }
+        *end = base + offsetAt(count);
+        return *end <= length;
+    }
+
+    // Top DICT operands of interest: charset 15, CharStrings 17, Private 18,
+    // FDArray 12 36, FDSelect 12 37.
+    std::map<int, std::vector<long>> ReadCffDict(const uint8_t* dict, size_t length) {
+        std::map<int, std::vector<long>> ops;
+        std::vector<long> operands;
+        for (size_t i = 0; i < length;) {
+            uint8_t b = dict[i];
+            if (b <= 21) {
+                int op = b;
+                ++i;
+                if (b == 12 && i < length) op = 1200 + dict[i++];
+                ops[op] = operands;
+                operands.clear();
+            } else if (b == 28 && i + 2 < length) {
+                operands.push_back((int16_t)U16(dict + i + 1));
+                i += 3;
+            } else if (b == 29 && i + 4 < length) {
+                operands.push_back((int32_t)U32(dict + i + 1));
+                i += 5;
+            } else if (b == 30) {
+                ++i;
+                while (i < length && (dict[i] & 0x0F) != 0x0F && (dict[i] & 0xF0) != 0xF0) ++i;
+                ++i;
+                operands.push_back(0);
+            } else if (b >= 32 && b <= 246) {
+                operands.push_back((long)b - 139);
+                ++i;
+            } else if (b >= 247 && b <= 250 && i + 1 < length) {
+                operands.push_back(((long)b - 247) * 256 + dict[i + 1] + 108);
+                i += 2;
+            } else if (b >= 251 && b <= 254 && i + 1 < length) {
+                operands.push_back(-((long)b - 251) * 256 - dict[i + 1] - 108);
+                i += 2;
+            } else {
+                break;
+            }
+        }
+        return ops;
+    }
+
+    bool ReadCff(const Sfnt& font, Outlines& out, std::string& problem) {
+        size_t length = 0;
+        const uint8_t* cff = font.Find("CFF ", &length);
+        if (!cff || length < 4) return false;
+        out.cff = true;
+        std::vector<std::pair<size_t, size_t>> names, topDicts, charStrings;
+        size_t pos = cff[2];
+        if (!ReadCffIndex(cff, length, pos, names, &pos) || !ReadCffIndex(cff, length, pos, topDicts, &pos) ||
+            topDicts.empty()) {
+            problem = "CFF header indexes";
+            return false;
+        }
+        auto top = ReadCffDict(cff + topDicts[0].first, topDicts[0].second - topDicts[0].first);
+        if (top[17].size() != 1) {
+            problem = "CFF CharStrings operator";
+            return false;
+        }
+        size_t csEnd = 0;
+        if (!ReadCffIndex(cff, length, (size_t)top[17][0], charStrings, &csEnd) ||
+            charStrings.size() != font.GlyphCount()) {
+            problem = "CFF CharStrings index";
+            return false;
+        }
+        out.glyphs.clear();
+        for (const auto& item : charStrings)
+            out.glyphs.push_back(std::vector<uint8_t>(cff + item.first, cff + item.second));
+
+        // Offsets the subsetter shifts must still land on their structures.
+        if (top.count(18) && (top[18].size() != 2 || top[18][1] < 0 || (size_t)top[18][1] > length ||
+            (size_t)top[18][0] > length - (size_t)top[18][1])) {
+            problem = "CFF Private DICT range";
+            return false;
+        }
+        if (top.count(15) && top[15].size() == 1 && top[15][0] > 2 && (size_t)top[15][0] >= length) {
+            problem = "CFF charset offset";
+            return false;
+        }
+        if (top.count(1236)) {
+            std::vector<std::pair<size_t, size_t>> fds;
+            size_t fdEnd = 0;
+            if (top[1236].size() != 1 || !ReadCffIndex(cff, length, (size_t)top[1236][0], fds, &fdEnd)) {
+                problem = "CFF FDArray index";
+                return false;
+            }
+            for (const auto& fd : fds) {
+                auto dict = ReadCffDict(cff + fd.first, fd.second - fd.first);
+                if (dict[18].size() != 2 || (size_t)dict[18][0] + (size_t)dict[18][1] > length) {
+                    problem = "CFF FD Private range";
+                    return false;
+                }
+            }
+        }
+        if (top.count(1237) && (top[1237].size() != 1 || (size_t)top[1237][0] >= length)) {
+            problem = "CFF FDSelect offset";
+            return false;
+        }
+        return true;
+    }
+
+    bool ReadOutlines(const Sfnt& font, Outlines& out, std::string& problem) {
+        if (font.tables.count(Tag("glyf"))) {
+            if (ReadGlyf(font, out)) return true;
+            problem = "glyf/loca";
+            return false;
+        }
+        if (ReadCff(font, out, problem)) return true;
+        if (problem.empty()) problem = "no outlines";
+        return false;
+    }
+
+    // Components referenced by a composite glyf entry.
+    std::vector<uint16_t> GlyfComponents(const std::vector<uint8_t>& glyph) {
+        std::vector<uint16_t> components;
+        if (glyph.size() < 10 || (int16_t)U16(glyph.data()) >= 0) return components;
+        size_t pos = 10;
+        while (pos + 4 <= glyph.size()) {
+            uint16_t flags = U16(glyph.data() + pos);
+            components.push_back(U16(glyph.data() + pos + 2));
+            pos += 4 + ((flags & 0x0001) ? 4 : 2);
+            if (flags & 0x0008) pos += 2;
+            else if (flags & 0x0040) pos += 4;
+            else if (flags & 0x0080) pos += 8;
+            if (!(flags & 0x0020)) break;
+        }
+        return components;
+    }
+
+    bool IsDroppedOutline(const Outlines& outlines, const std::vector<uint8_t>& glyph) {
+        return outlines.cff ? (glyph.size() == 1 && glyph[0] == 14) : glyph.empty();
+    }
+
+    // Kept outlines must match the source byte for byte; glyf entries may
+    // carry up to three bytes of alignment padding.
+    bool SameOutline(const Outlines& outlines, const std::vector<uint8_t>& source, const std::vector<uint8_t>& subset) {
+        if (outlines.cff) return source == subset;
+        if (subset.size() < source.size() || subset.size() - source.size() > 3) return false;
+        return std::equal(source.begin(), source.end(), subset.begin());
+    }
+
+    std::vector<uint8_t> WriteSfnt(uint32_t version, const std::map<uint32_t, std::vector<uint8_t>>& tables) {
+        std::vector<uint8_t> out;
+        PutU32(out, version);
+        PutU16(out, (uint16_t)tables.size());
+        PutU16(out, 0);
+        PutU16(out, 0);
+        PutU16(out, 0);
+        size_t offset = 12 + tables.size() * 16;
+        for (const auto& table : tables) {
+            PutU32(out, table.first);
+            PutU32(out, Checksum(table.second.data(), table.second.size()));
+            PutU32(out, (uint32_t)offset);
+            PutU32(out, (uint32_t)table.second.size());
+            offset += (table.second.size() + 3) & ~(size_t)3;
+        }
+        for (const auto& table : tables) {
+            out.insert(out.end(), table.second.begin(), table.second.end());
+            while (out.size() & 3) out.push_back(0);
+        }
+        return out;
+    }
+
+    // Same layout as WriteSfnt, with the directory records in `order` instead of
+    // tag order.
+    std::vector<uint8_t> WriteSfntInOrder(uint32_t version, const std::map<uint32_t, std::vector<uint8_t>>& tables,
+        const std::vector<uint32_t>& order) {
+        std::vector<uint8_t> out = WriteSfnt(version, tables);
+        std::vector<uint8_t> records(out.begin() + 12, out.begin() + 12 + tables.size() * 16);
+        for (size_t i = 0; i < order.size(); ++i) {
+            size_t from = (size_t)std::distance(tables.begin(), tables.find(order[i]));
+            std::copy(records.begin() + from * 16, records.begin() + from * 16 + 16, out.begin() + 12 + i * 16);
+        }
+        return out;
+    }
+
+    std::map<uint32_t, std::vector<uint8_t>> CopyTables(const Sfnt& font) {
+        std::map<uint32_t, std::vector<uint8_t>> tables;
+        for (const auto& table : font.tables) {
+            const uint8_t* data = font.bytes->data() + table.second.offset;
+            tables[table.first] = std::vector<uint8_t>(data, data + table.second.length);
+        }
+        return tables;
+    }
+
+    std::vector<uint32_t> DecodeUtf8(const std::string& text) {
+        std::vector<uint32_t> out;
+        for (size_t i = 0; i < text.size();) {
+            uint8_t b = (uint8_t)text[i];
+            size_t extra = b < 0x80 ? 0 : (b >> 5) == 6 ? 1 : (b >> 4) == 14 ? 2 : (b >> 3) == 30 ? 3 : 0;
+            uint32_t cp = extra == 0 ? b : extra == 1 ? (b & 0x1F) : extra == 2 ? (b & 0x0F) : (b & 0x07);
+            if (i + extra >= text.size()) break;
+            for (size_t k = 1; k <= extra; ++k) cp = (cp << 6) | ((uint8_t)text[i + k] & 0x3F);
+            out.push_back(cp);
+            i += extra + 1;
+        }
+        return out;
+    }
+
+    // Subsets `codepoints` and checks the result against the source font.
+    void CheckRoundTrip(const std::string& name, const std::vector<uint8_t>& data, const Sfnt& source,
+        const std::map<uint32_t, uint16_t>& sourceCmap, const Outlines& sourceOutlines,
+        const std::vector<uint32_t>& codepoints, bool expectShrink) {
+        std::vector<DWORD> request(codepoints.begin(), codepoints.end());
+        std::vector<BYTE> subset;
+        bool ok = FontPatcher::SubsetFont(data, request.data(), request.size(), subset);
+        Check(ok, name, "SubsetFont succeeds");
+        if (!ok) return;
+
+        Sfnt result;
+        Check(result.Parse(subset), name, "subset table directory is in bounds");
+        if (!result.bytes) return;
+        Check(result.version == source.version, name, "sfnt version preserved");
+        Check(std::is_sorted(result.order.begin(), result.order.end()), name, "table records sorted by tag");
+        Check(!result.tables.count(Tag("DSIG")), name, "DSIG dropped");
+        for (const char* tag : { "cmap", "head", "glyf", "loca", "CFF ", "OS/2" }) {
+            auto it = result.tables.find(Tag(tag));
+            if (it == result.tables.end()) continue;
+            Check(it->second.offset % 4 == 0, name, "rewritten table is 4-byte aligned");
+            if (Tag(tag) == Tag("head")) continue;
+            Check(Checksum(subset.data() + it->second.offset, it->second.length) == it->second.checksum,
+                name, "rewritten table checksum");
+        }
+
+        // Tables keyed by glyph id are carried over unchanged.
+        Check(result.GlyphCount() == source.GlyphCount(), name, "maxp glyph count unchanged");
+        Check(result.Copy("hmtx") == source.Copy("hmtx"), name, "hmtx unchanged");
+        Check(result.Copy("hhea") == source.Copy("hhea"), name, "hhea unchanged");
+        Check(result.Copy("vmtx") == source.Copy("vmtx"), name, "vmtx unchanged");
+
+        std::map<uint32_t, uint16_t> subsetCmap = ReadCmap(result);
+        size_t expectedMapped = 0;
+        bool mappingsMatch = true;
+        std::vector<uint32_t> sorted(codepoints);
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+        for (uint32_t cp : sorted) {
+            auto it = sourceCmap.find(cp);
+            if (it == sourceCmap.end()) continue;
+            ++expectedMapped;
+            auto kept = subsetCmap.find(cp);
+            if (kept == subsetCmap.end() || kept->second != it->second) mappingsMatch = false;
+        }
+        Check(mappingsMatch, name, "requested code points keep their glyph ids");
+        Check(subsetCmap.size() == expectedMapped, name, "cmap maps only requested code points");
+
+        Outlines outlines;
+        std::string problem;
+        bool parsed = ReadOutlines(result, outlines, problem);
+        Check(parsed, name, ("subset outlines parse: " + problem).c_str());
+        if (!parsed || outlines.glyphs.size() != sourceOutlines.glyphs.size()) return;
+
+        bool keptMatch = true;
+        for (const auto& entry : subsetCmap) {
+            if (!SameOutline(outlines, sourceOutlines.glyphs[entry.second], outlines.glyphs[entry.second]))
+                keptMatch = false;
+        }
+        Check(keptMatch, name, "mapped glyph outlines identical to source");
+        Check(SameOutline(outlines, sourceOutlines.glyphs[0], outlines.glyphs[0]), name, ".notdef kept");
+
+        size_t kept = 0;
+        bool componentsKept = true;
+        bool othersIdentical = true;
+        for (size_t g = 0; g < outlines.glyphs.size(); ++g) {
+            if (IsDroppedOutline(outlines, outlines.glyphs[g]) && !IsDroppedOutline(outlines, sourceOutlines.glyphs[g]))
+                continue;
+            ++kept;
+            if (!SameOutline(outlines, sourceOutlines.glyphs[g], outlines.glyphs[g])) othersIdentical = false;
+            if (outlines.cff) continue;
+            for (uint16_t component : GlyfComponents(outlines.glyphs[g])) {
+                if (component >= outlines.glyphs.size() ||
+                    (outlines.glyphs[component].empty() && !sourceOutlines.glyphs[component].empty()))
+                    componentsKept = false;
+            }
+        }
+        Check(othersIdentical, name, "every kept outline identical to source");
+        Check(componentsKept, name, "composite components kept");
+        if (expectShrink) {
+            Check(kept < outlines.glyphs.size(), name, "some glyphs dropped");
+            Check(subset.size() < data.size(), name, "subset smaller than source");
+        }
+        printf("  %zu code points -> %zu mapped, %zu/%zu outlines kept, %zu -> %zu bytes\n",
+            sorted.size(), subsetCmap.size(), kept, outlines.glyphs.size(), data.size(), subset.size());
+    }
+
+    // A GSUB with one single-substitution lookup whose format-2 coverage
+    // repeats the full glyph range; expansion must stay bounded.
+    std::vector<uint8_t> BuildCoverageBombGsub() {
+        const uint16_t ranges = 4096;
+        std::vector<uint8_t> gsub;
+        PutU32(gsub, 0x00010000);
+        PutU16(gsub, 10);   // ScriptList
+        PutU16(gsub, 12);   // FeatureList
+        PutU16(gsub, 14);   // LookupList
+        PutU16(gsub, 0);    // empty ScriptList
+        PutU16(gsub, 0);    // empty FeatureList
+        PutU16(gsub, 1);    // LookupList: one lookup at +4
+        PutU16(gsub, 4);
+        PutU16(gsub, 1);    // lookup type 1
+        PutU16(gsub, 0);
+        PutU16(gsub, 1);    // one subtable at +8
+        PutU16(gsub, 8);
+        PutU16(gsub, 1);    // format 1, coverage at +6, delta 1
+        PutU16(gsub, 6);
+        PutU16(gsub, 1);
+        PutU16(gsub, 2);    // coverage format 2
+        PutU16(gsub, ranges);
+        for (uint16_t i = 0; i < ranges; ++i) {
+            PutU16(gsub, 0);
+            PutU16(gsub, 0xFFFF);
+            PutU16(gsub, 0);
+        }
+        return gsub;
+    }
+
+    void CheckDamagedInputs(const std::string& name, const std::vector<uint8_t>& data, const Sfnt& source,
+        const std::vector<uint32_t>& codepoints) {
+        std::vector<DWORD> request(codepoints.begin(), codepoints.end());
+        std::vector<BYTE> subset;
+
+        Check(!FontPatcher::SubsetFont(data, request.data(), 0, subset) && subset.empty(), name,
+            "empty code point set rejected");
+
+        std::vector<BYTE> collection;
+        PutU32(collection, Tag("ttcf"));
+        PutU32(collection, 0x00010000);
+        PutU32(collection, 1);
+        PutU32(collection, 16);
+        collection.insert(collection.end(), data.begin(), data.end());
+        Check(!FontPatcher::SubsetFont(collection, request.data(), request.size(), subset), name,
+            "collection rejected");
+
+        auto tables = CopyTables(source);
+        tables[Tag("GSUB")] = BuildCoverageBombGsub();
+        std::vector<uint8_t> bomb = WriteSfnt(source.version, tables);
+        if (FontPatcher::SubsetFont(bomb, request.data(), request.size(), subset)) {
+            Sfnt result;
+            Check(result.Parse(subset), name, "overlapping GSUB coverage subset is well formed");
+        }
+
+        // Truncations and byte flips only need to fail cleanly or stay parseable.
+        uint32_t seed = 0x9E3779B9u;
+        bool wellFormed = true;
+        for (int round = 0; round < 256; ++round) {
+            seed = seed * 1664525u + 1013904223u;
+            std::vector<uint8_t> damaged(data);
+            if (round < 32) {
+                damaged.resize((size_t)seed % damaged.size());
+            } else {
+                for (int flip = 0; flip < 8; ++flip) {
+                    seed = seed * 1664525u + 1013904223u;
+                    damaged[(size_t)seed % damaged.size()] ^= (uint8_t)(seed >> 24) | 1;
+                }
+            }
+            if (FontPatcher::SubsetFont(damaged, request.data(), request.size(), subset)) {
+                Sfnt result;
+                if (!result.Parse(subset)) wellFormed = false;
+            }
+        }
+        Check(wellFormed, name, "damaged inputs fail or stay well formed");
+    }
+
+    // Directory sorted and free of duplicates, every table checksum and the
+    // whole-file checksum valid, and the same table set as the source.
+    void CheckRebuiltFont(const std::string& name, const std::vector<uint8_t>& data, const Sfnt& source,
+        const char* what) {
+        Sfnt result;
+        Check(result.Parse(data), name, what);
+        if (!result.bytes) return;
+        Check(std::is_sorted(result.order.begin(), result.order.end()), name, "rebuilt directory sorted by tag");
+        Check(result.order.size() == result.tables.size(), name, "rebuilt directory has no duplicate tags");
+        Check(result.tables.size() == source.tables.size(), name, "rebuilt font keeps the table set");
+        bool checksums = true;
+        for (const auto& table : result.tables) {
+            if (table.first == Tag("head")) continue;
+            if (Checksum(data.data() + table.second.offset, table.second.length) != table.second.checksum)
+                checksums = false;
+        }
+        Check(checksums, name, "rebuilt table checksums");
+        if (source.tables.count(Tag("head")))
+            Check(Checksum(data.data(), data.size()) == 0xB1B0AFBAu, name, "rebuilt whole-file checksum");
+    }
+
+    void CheckTableBuilder(const std::string& name, const Sfnt& source, const std::map<uint32_t, uint16_t>& cmap) {
+        std::vector<uint8_t> sorted = WriteSfnt(source.version, CopyTables(source));
+        std::vector<uint32_t> reversed;
+        for (const auto& table : source.tables) reversed.insert(reversed.begin(), table.first);
+        std::vector<uint8_t> unsorted = WriteSfntInOrder(source.version, CopyTables(source), reversed);
+
+        for (const std::vector<uint8_t>* input : { &sorted, &unsorted }) {
+            std::string label = name + (input == &sorted ? "" : " (unsorted directory)");
+            std::vector<BYTE> renamed;
+            bool ok = FontPatcher::CloneWithNameTableFamily(*input,
+                L"SimpleFontHook Builder Check Family With A Longer Name", renamed);
+            Check(ok || !source.tables.count(Tag("name")), label, "CloneWithNameTableFamily succeeds");
+            if (ok) CheckRebuiltFont(label, renamed, source, "renamed font parses");
+
+            if (cmap.size() < 2) continue;
+            std::vector<BYTE> aliased(*input);
+            FontPatcher::CmapAlias alias = { cmap.begin()->first, std::next(cmap.begin())->first };
+            ok = FontPatcher::PatchCmapAliases(aliased, &alias, 1);
+            Check(ok, label, "PatchCmapAliases succeeds");
+            if (!ok) continue;
+            CheckRebuiltFont(label, aliased, source, "aliased font parses");
+            Sfnt result;
+            if (result.Parse(aliased)) {
+                std::map<uint32_t, uint16_t> patched = ReadCmap(result);
+                Check(patched.count(alias.fromCodepoint) && patched[alias.fromCodepoint] == cmap.at(alias.toCodepoint),
+                    label, "aliased code point maps to the target glyph");
+            }
+        }
+    }
+
+    // --- Benchmark. ---
+
+    double UsPerApply(int iterations, const std::function<size_t()>& apply) {
+        size_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) sink += apply();
+        auto end = std::chrono::steady_clock::now();
+        if (sink == 1) printf("(sink)\n");
+        return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+    }
+
+    // The path the builder replaced: copy the font, append the new table,
+    // point the directory entry at it and re-sum the whole file for
+    // checkSumAdjustment.
+    std::vector<uint8_t> AppendTableBaseline(const std::vector<uint8_t>& data, const Sfnt& source,
+        uint32_t tag, const std::vector<uint8_t>& table) {
+        std::vector<uint8_t> out(data);
+        while (out.size() & 3) out.push_back(0);
+        size_t offset = out.size();
+        out.insert(out.end(), table.begin(), table.end());
+        while (out.size() & 3) out.push_back(0);
+        for (size_t i = 0; i < source.order.size(); ++i) {
+            uint8_t* record = out.data() + 12 + i * 16;
+            if (U32(record) != tag) continue;
+            uint32_t sum = Checksum(out.data() + offset, table.size());
+            for (int k = 0; k < 4; ++k) {
+                record[4 + k] = (uint8_t)(sum >> (24 - 8 * k));
+                record[8 + k] = (uint8_t)((uint32_t)offset >> (24 - 8 * k));
+                record[12 + k] = (uint8_t)((uint32_t)table.size() >> (24 - 8 * k));
+            }
+        }
+        auto head = source.tables.find(Tag("head"));
+        if (head != source.tables.end() && head->second.length >= 12) {
+            memset(out.data() + head->second.offset + 8, 0, 4);
+            uint32_t adjustment = 0xB1B0AFBAu - Checksum(out.data(), out.size());
+            for (int k = 0; k < 4; ++k) out[head->second.offset + 8 + k] = (uint8_t)(adjustment >> (24 - 8 * k));
+        }
+        return out;
+    }
+
+    void BenchmarkTableEdits(const std::vector<uint8_t>& data, const Sfnt& source,
+        const std::map<uint32_t, uint16_t>& cmap, int iterations) {
+        printf("  edit        append us  builder us  speedup\n");
+        for (const char* tagName : { "name", "cmap" }) {
+            uint32_t tag = Tag(tagName);
+            if (!source.tables.count(tag)) continue;
+            std::vector<uint8_t> table = source.Copy(tagName);
+            table.resize(table.size() + 64, 0);     // a rebuilt table rarely fits the old slot
+            double append = UsPerApply(iterations, [&]() {
+                return AppendTableBaseline(data, source, tag, table).size();
+            });
+            double builder = UsPerApply(iterations, [&]() {
+                FontPatcher::SfntTableBuilder edit;
+                std::vector<BYTE> out;
+                std::vector<BYTE> replacement(table);
+                if (!edit.Load(data.data(), data.size(), 0) || !edit.ReplaceTable(tag, std::move(replacement)) ||
+                    !edit.Write(out))
+                    return (size_t)0;
+                return out.size();
+            });
+            printf("  replace %s  %9.1f  %10.1f  %6.1fx\n", tagName, append, builder, append / builder);
+        }
+
+        if (cmap.size() >= 2) {
+            FontPatcher::CmapAlias alias = { cmap.begin()->first, std::next(cmap.begin())->first };
+            double aliasUs = UsPerApply(iterations, [&]() {
+                std::vector<BYTE> out(data);
+                return FontPatcher::PatchCmapAliases(out, &alias, 1) ? out.size() : 0;
+            });
+            printf("  PatchCmapAliases end to end %.1f us\n", aliasUs);
+        }
+
+        // In-place hhea/OS/2 edits: the adjustment now reads the directory
+        // instead of summing the file.
+        std::vector<BYTE> patched(data);
+        double resum = UsPerApply(iterations, [&]() {
+            FontPatcher::PatchVerticalMetrics(patched, 880, 120, 0);
+            return (size_t)Checksum(patched.data(), patched.size());
+        });
+        double directory = UsPerApply(iterations, [&]() {
+            return FontPatcher::PatchVerticalMetrics(patched, 880, 120, 0) ? patched.size() : 0;
+        });
+        printf("  metrics       %9.1f  %10.1f  %6.1fx  (whole-file sum vs directory)\n", resum, directory,
+            resum / directory);
+    }
+
+    bool ReadFile(const char* path, std::string& out) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input) return false;
+        out.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    void CheckFont(const char* path, const std::vector<uint32_t>& text, int benchIterations) {
+        std::string raw;
+        if (!ReadFile(path, raw)) {
+            Check(false, path, "cannot open file");
+            return;
+        }
+        std::vector<uint8_t> data(raw.begin(), raw.end());
+        std::string name = path;
+        printf("%s\n", path);
+
+        Sfnt source;
+        std::string problem;
+        Outlines outlines;
+        if (!source.Parse(data) || source.tables.count(Tag("fvar")) || !ReadOutlines(source, outlines, problem)) {
+            printf("  skipped: not a static standalone font %s\n", problem.c_str());
+            return;
+        }
+        std::map<uint32_t, uint16_t> cmap = ReadCmap(source);
+        if (cmap.empty()) {
+            printf("  skipped: no Unicode cmap\n");
+            return;
+        }
+
+        // Sparse sample across the whole repertoire, plus printable ASCII.
+        std::vector<uint32_t> sample;
+        size_t step = 0;
+        for (const auto& entry : cmap) {
+            if (step++ % 7 == 0) sample.push_back(entry.first);
+        }
+        for (uint32_t cp = 0x20; cp < 0x7F; ++cp) sample.push_back(cp);
+        sample.push_back(0x10FFFF + 1);     // out of range, ignored
+
+        std::vector<uint32_t> all;
+        for (const auto& entry : cmap) all.push_back(entry.first);
+
+        CheckRoundTrip(name, data, source, cmap, outlines, sample, cmap.size() > 64);
+        CheckRoundTrip(name, data, source, cmap, outlines, std::vector<uint32_t>(1, cmap.begin()->first), cmap.size() > 1);
+        CheckRoundTrip(name, data, source, cmap, outlines, all, false);
+        if (!text.empty()) CheckRoundTrip(name, data, source, cmap, outlines, text, false);
+        CheckDamagedInputs(name, data, source, sample);
+        CheckTableBuilder(name, source, cmap);
+        if (benchIterations > 0) BenchmarkTableEdits(data, source, cmap, benchIterations);
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<uint32_t> text;
+    int benchIterations = 0;
+    int first = 1;
+    while (first + 1 < argc && strncmp(argv[first], "--", 2) == 0) {
+        if (strcmp(argv[first], "--text") == 0) {
+            std::string script;
+            if (!ReadFile(argv[first + 1], script)) {
+                fprintf(stderr, "cannot open %s\n", argv[first + 1]);
+                return 1;
+            }
+            text = DecodeUtf8(script);
+        } else if (strcmp(argv[first], "--bench") == 0) {
+            benchIterations = atoi(argv[first + 1]);
+        } else {
+            break;
+        }
+        first += 2;
+    }
+    if (first >= argc || strncmp(argv[first], "--", 2) == 0) {
+        fprintf(stderr, "usage: sfh_font_subset_check [--text script.txt] [--bench N] font.ttf [font.otf ...]\n");
+        return 2;
+    }
+
+    for (int i = first; i < argc; ++i) CheckFont(argv[i], text, benchIterations);
+    printf("%d checks, %d failed\n", g_checks, g_failures);
+    return g_failures ? 1 : 0;
+}
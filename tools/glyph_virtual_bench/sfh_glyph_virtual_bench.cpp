@@ -0,0 +1,413 @@
+// Benchmark for the paged glyph alias tables behind glyph-index virtualization.
+//
+//   g++ -std=c++17 -O2 -pthread -I tools/win32_compat
+//       -o sfh_glyph_virtual_bench tools/glyph_virtual_bench/sfh_glyph_virtual_bench.cpp
+//   ./sfh_glyph_virtual_bench [--fonts N] [--glyphs N] [--distinct N]
+//
+// GlyphVirtual (the DLL header, compiled unchanged) is measured against the
+// baseline it replaced: one std::mutex and two unordered_maps keyed by (font,
+// config version, glyph), taken for every glyph. The per-glyph wrappers below
+// mirror VirtualizeGlyphIndex and TranslateVirtualGlyphIndex without the GDI
+// and config calls around them. Both implementations must hand out the same
+// aliases for the same stream.
+//
+// The run table then compares those per-glyph wrappers with the run wrappers
+// that mirror VirtualizeGlyphIndices and TranslateGlyphIndexArray, on runs of
+// 1 to 4096 glyphs as ExtTextOutW(ETO_GLYPH_INDEX), GetGlyphIndicesW and
+// GetCharacterPlacementW pass them. Both must produce the same run.
+#include "../../SimpleFontHook/hooks/glyph_virtual_table.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    struct HFONT__ { int unused; };
+    typedef HFONT__* HFONT;
+
+    const LONG kConfigVersion = 3;
+
+    int g_failures = 0;
+
+    void Fail(const std::string& what) {
+        ++g_failures;
+        printf("FAIL %s\n", what.c_str());
+    }
+
+    // --- Baseline: the map-based path this table replaced. ---
+
+    struct GlyphMapKey {
+        HFONT font;
+        LONG configVersion;
+        WORD glyphIndex;
+
+        bool operator==(const GlyphMapKey& other) const {
+            return font == other.font &&
+                configVersion == other.configVersion &&
+                glyphIndex == other.glyphIndex;
+        }
+    };
+
+    struct GlyphMapKeyHash {
+        size_t operator()(const GlyphMapKey& key) const {
+            size_t h = std::hash<void*>()(key.font);
+            h ^= (size_t)key.configVersion * 16777619u;
+            h ^= (size_t)key.glyphIndex * 2166136261u;
+            return h;
+        }
+    };
+
+    std::mutex g_mapMutex;
+    std::unordered_map<GlyphMapKey, WORD, GlyphMapKeyHash> g_realToVirtualGlyph;
+    std::unordered_map<GlyphMapKey, WORD, GlyphMapKeyHash> g_virtualToRealGlyph;
+
+    WORD MapVirtualizeGlyphIndex(HFONT font, WORD realGlyph) {
+        if (!font || realGlyph == 0 || realGlyph == 0xFFFF)
+            return realGlyph;
+
+        std::lock_guard<std::mutex> lock(g_mapMutex);
+        LONG version = kConfigVersion;
+        GlyphMapKey realKey = { font, version, realGlyph };
+        auto existing = g_realToVirtualGlyph.find(realKey);
+        if (existing != g_realToVirtualGlyph.end())
+            return existing->second;
+
+        WORD salt = (WORD)(((version * 251u) ^ (((uintptr_t)font >> 4) & 0xFFFFu)) & 0xFFFFu);
+        WORD candidate = (WORD)(realGlyph ^ salt);
+        if (candidate == 0 || candidate == 0xFFFF) candidate = (WORD)(realGlyph + 1);
+        if (candidate == 0 || candidate == 0xFFFF) candidate = 1;
+
+        for (int i = 0; i < 0xFFFE; ++i) {
+            GlyphMapKey virtualKey = { font, version, candidate };
+            auto mapped = g_virtualToRealGlyph.find(virtualKey);
+            if (mapped == g_virtualToRealGlyph.end() || mapped->second == realGlyph) {
+                g_realToVirtualGlyph[realKey] = candidate;
+                g_virtualToRealGlyph[virtualKey] = realGlyph;
+                return candidate;
+            }
+            ++candidate;
+            if (candidate == 0 || candidate == 0xFFFF) candidate = 1;
+        }
+
+        return realGlyph;
+    }
+
+    WORD MapTranslateVirtualGlyphIndex(HFONT font, WORD glyph) {
+        if (!font || glyph == 0 || glyph == 0xFFFF)
+            return glyph;
+
+        std::lock_guard<std::mutex> lock(g_mapMutex);
+        GlyphMapKey key = { font, kConfigVersion, glyph };
+        auto it = g_virtualToRealGlyph.find(key);
+        if (it == g_virtualToRealGlyph.end())
+            return glyph;
+        return it->second;
+    }
+
+    // --- Paged tables, through the same calls the DLL wrappers make. ---
+
+    std::mutex g_tableMutex;
+    GlyphVirtual::Registry<HFONT> g_tables;
+
+    bool AlwaysLive(HFONT) { return true; }
+
+    WORD TableVirtualizeGlyphIndex(HFONT font, WORD realGlyph) {
+        if (!font || realGlyph == 0 || realGlyph == 0xFFFF)
+            return realGlyph;
+
+        {
+            GlyphVirtual::ReadScope<HFONT> readScope(g_tables);
+            GlyphVirtual::Table* table = GlyphVirtual::FindCurrent(g_tables, font, kConfigVersion);
+            WORD virtualGlyph = table ? GlyphVirtual::ReadAlias(table->realToVirtual, realGlyph) : 0;
+            if (virtualGlyph) return virtualGlyph;
+        }
+        std::lock_guard<std::mutex> lock(g_tableMutex);
+        GlyphVirtual::Table* table = GlyphVirtual::GetOrCreateLocked(g_tables, font, kConfigVersion, AlwaysLive);
+        if (!table) return realGlyph;
+        return GlyphVirtual::AssignLocked(table, font, kConfigVersion, realGlyph);
+    }
+
+    WORD TableTranslateVirtualGlyphIndex(HFONT font, WORD glyph) {
+        if (!font || glyph == 0 || glyph == 0xFFFF)
+            return glyph;
+
+        GlyphVirtual::ReadScope<HFONT> readScope(g_tables);
+        GlyphVirtual::Table* table = GlyphVirtual::FindCurrent(g_tables, font, kConfigVersion);
+        if (!table) return glyph;
+        WORD realGlyph = GlyphVirtual::ReadAlias(table->virtualToReal, glyph);
+        return realGlyph ? realGlyph : glyph;
+    }
+
+    // VirtualizeGlyphIndices: one table fetch for the known prefix, one lock for
+    // the rest.
+    void TableVirtualizeGlyphIndices(HFONT font, WORD* glyphs, int count) {
+        int firstMiss;
+        {
+            GlyphVirtual::ReadScope<HFONT> readScope(g_tables);
+            firstMiss = GlyphVirtual::VirtualizeKnown(GlyphVirtual::FindCurrent(g_tables, font, kConfigVersion),
+                glyphs, count);
+        }
+        if (firstMiss == count) return;
+
+        std::lock_guard<std::mutex> lock(g_tableMutex);
+        GlyphVirtual::Table* table = GlyphVirtual::GetOrCreateLocked(g_tables, font, kConfigVersion, AlwaysLive);
+        if (!table) return;
+        GlyphVirtual::VirtualizeRestLocked(table, font, kConfigVersion, glyphs, firstMiss, count);
+    }
+
+    // TranslateGlyphIndexArray: `output` stays empty when nothing translates.
+    void TableTranslateGlyphIndexArray(HFONT font, const WORD* input, int count, std::vector<WORD>& output) {
+        output.clear();
+        GlyphVirtual::ReadScope<HFONT> readScope(g_tables);
+        GlyphVirtual::Table* table = GlyphVirtual::FindCurrent(g_tables, font, kConfigVersion);
+        int first = GlyphVirtual::FindFirstVirtual(table, input, count);
+        if (first == count) return;
+
+        output.assign(input, input + count);
+        GlyphVirtual::TranslateRun(table, output.data(), first, count);
+    }
+
+    void FreeTables() {
+        std::lock_guard<std::mutex> lock(g_tableMutex);
+        GlyphVirtual::RetireAllLocked(g_tables);
+    }
+
+    // --- Workload. ---
+
+    struct Options {
+        uint32_t fonts = 8;
+        uint32_t glyphs = 4000000;
+        uint32_t distinct = 3000;
+    };
+
+    HFONT FontHandle(uint32_t index) {
+        uint32_t uniqueness = (index * 0x9Du + 0x31u) & 0xFF;
+        return (HFONT)(uintptr_t)(0x0A000000u | (uniqueness << 16) | ((0x0400u + index) & 0xFFFF));
+    }
+
+    struct GlyphUse {
+        HFONT font;
+        WORD glyph;
+    };
+
+    // Script-like glyph use: a Zipf distribution over `distinct` glyph ids spread
+    // across a CJK font's glyph range, split over `fonts` replacement fonts.
+    std::vector<GlyphUse> BuildStream(const Options& options) {
+        std::vector<WORD> ids(options.distinct);
+        uint32_t state = 0x2545F491u;
+        auto next = [&]() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        };
+        for (WORD& id : ids) id = (WORD)(1 + next() % 0xFFFD);
+
+        std::vector<double> cumulative(options.distinct);
+        double sum = 0;
+        for (uint32_t i = 0; i < options.distinct; ++i) {
+            sum += 1.0 / std::pow((double)(i + 1), 1.1);
+            cumulative[i] = sum;
+        }
+
+        std::vector<GlyphUse> stream(1u << 16);
+        for (GlyphUse& use : stream) {
+            double pick = (double)(next() % 1000000) / 1000000.0 * sum;
+            size_t rank = (size_t)(std::lower_bound(cumulative.begin(), cumulative.end(), pick) - cumulative.begin());
+            use.glyph = ids[std::min<size_t>(rank, ids.size() - 1)];
+            use.font = FontHandle(next() % options.fonts);
+        }
+        return stream;
+    }
+
+    template <typename Step>
+    double NsPerGlyph(const std::vector<GlyphUse>& stream, uint32_t glyphs, Step step) {
+        uint32_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < glyphs; ++i) {
+            const GlyphUse& use = stream[i & (stream.size() - 1)];
+            sink += step(use);
+        }
+        auto end = std::chrono::steady_clock::now();
+        if (sink == 0xFFFFFFFFu) printf("(sink)\n");
+        return std::chrono::duration<double, std::nano>(end - start).count() / glyphs;
+    }
+
+    const int kRunLengths[] = { 1, 4, 16, 64, 256, 1024, 4096 };
+
+    // Runs cut from `stream` in order, each drawn with one font. `step` gets a
+    // fresh copy of the run, so both paths pay the same copy.
+    template <typename Step>
+    double NsPerRunGlyph(const std::vector<GlyphUse>& stream, uint32_t fonts, int length, uint32_t glyphs,
+        HFONT fixedFont, Step step) {
+        std::vector<WORD> source(stream.size());
+        for (size_t i = 0; i < stream.size(); ++i) source[i] = stream[i].glyph;
+        std::vector<WORD> run((size_t)length);
+        uint32_t runs = std::max<uint32_t>(1, glyphs / (uint32_t)length);
+        uint32_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t r = 0; r < runs; ++r) {
+            size_t offset = ((size_t)r * (size_t)length) & (stream.size() - 1);
+            if (offset + (size_t)length > stream.size()) offset = 0;
+            std::copy(source.begin() + (std::ptrdiff_t)offset, source.begin() + (std::ptrdiff_t)(offset + length),
+                run.begin());
+            sink += step(fixedFont ? fixedFont : FontHandle(r % fonts), run.data(), length);
+        }
+        auto end = std::chrono::steady_clock::now();
+        if (sink == 0xFFFFFFFFu) printf("(sink)\n");
+        return std::chrono::duration<double, std::nano>(end - start).count() / ((double)runs * length);
+    }
+
+    uint32_t PerGlyphVirtualize(HFONT font, WORD* glyphs, int count) {
+        for (int i = 0; i < count; ++i) glyphs[i] = TableVirtualizeGlyphIndex(font, glyphs[i]);
+        return glyphs[count - 1];
+    }
+
+    uint32_t RunVirtualize(HFONT font, WORD* glyphs, int count) {
+        TableVirtualizeGlyphIndices(font, glyphs, count);
+        return glyphs[count - 1];
+    }
+
+    uint32_t PerGlyphTranslate(HFONT font, WORD* glyphs, int count) {
+        for (int i = 0; i < count; ++i) glyphs[i] = TableTranslateVirtualGlyphIndex(font, glyphs[i]);
+        return glyphs[count - 1];
+    }
+
+    std::vector<WORD> g_translated;
+
+    uint32_t RunTranslate(HFONT font, WORD* glyphs, int count) {
+        TableTranslateGlyphIndexArray(font, glyphs, count, g_translated);
+        return g_translated.empty() ? glyphs[count - 1] : g_translated[(size_t)count - 1];
+    }
+
+    // Every run through both forms must come out identical, including the
+    // virtualize pass that assigns aliases for glyphs not seen yet.
+    void CheckRuns(const std::vector<GlyphUse>& stream, uint32_t fonts) {
+        for (int length : kRunLengths) {
+            for (size_t offset = 0; offset + (size_t)length <= stream.size(); offset += (size_t)length * 7 + 1) {
+                HFONT font = FontHandle((uint32_t)(offset % fonts));
+                std::vector<WORD> perGlyph((size_t)length);
+                for (int i = 0; i < length; ++i) perGlyph[(size_t)i] = stream[offset + (size_t)i].glyph;
+                std::vector<WORD> run = perGlyph;
+                PerGlyphVirtualize(font, perGlyph.data(), length);
+                TableVirtualizeGlyphIndices(font, run.data(), length);
+                if (run != perGlyph) {
+                    Fail("run virtualization differs at length " + std::to_string(length));
+                    return;
+                }
+                std::vector<WORD> translated;
+                TableTranslateGlyphIndexArray(font, run.data(), length, translated);
+                PerGlyphTranslate(font, perGlyph.data(), length);
+                if ((translated.empty() ? run : translated) != perGlyph) {
+                    Fail("run translation differs at length " + std::to_string(length));
+                    return;
+                }
+            }
+        }
+    }
+
+    bool ParseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            std::string arg = argv[i];
+            uint32_t value = (uint32_t)strtoul(argv[i + 1], nullptr, 10);
+            if (arg == "--fonts") options.fonts = value;
+            else if (arg == "--glyphs") options.glyphs = value;
+            else if (arg == "--distinct") options.distinct = value;
+            else return false;
+        }
+        return argc % 2 == 1 && options.fonts > 0 && options.fonts <= 0x7000 && options.glyphs > 0 &&
+            options.distinct > 0 && options.distinct <= 0xFFFD;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: sfh_glyph_virtual_bench [--fonts N] [--glyphs N] [--distinct N]\n");
+        return 2;
+    }
+
+    std::vector<GlyphUse> stream = BuildStream(options);
+    printf("%u fonts, %u distinct glyphs, %u glyphs per pass\n", options.fonts, options.distinct, options.glyphs);
+
+    // The first pass assigns every alias, so it also measures the write path.
+    uint32_t coldGlyphs = (uint32_t)stream.size();
+    double mapCold = NsPerGlyph(stream, coldGlyphs, [](const GlyphUse& use) {
+        return (uint32_t)MapVirtualizeGlyphIndex(use.font, use.glyph);
+    });
+    double tableCold = NsPerGlyph(stream, coldGlyphs, [](const GlyphUse& use) {
+        return (uint32_t)TableVirtualizeGlyphIndex(use.font, use.glyph);
+    });
+
+    for (const GlyphUse& use : stream) {
+        WORD fromMap = MapVirtualizeGlyphIndex(use.font, use.glyph);
+        WORD fromTable = TableVirtualizeGlyphIndex(use.font, use.glyph);
+        if (fromMap != fromTable) {
+            Fail("alias differs for glyph " + std::to_string(use.glyph));
+            break;
+        }
+        if (TableTranslateVirtualGlyphIndex(use.font, fromTable) != use.glyph) {
+            Fail("alias does not translate back for glyph " + std::to_string(use.glyph));
+            break;
+        }
+    }
+
+    double mapVirtualize = NsPerGlyph(stream, options.glyphs, [](const GlyphUse& use) {
+        return (uint32_t)MapVirtualizeGlyphIndex(use.font, use.glyph);
+    });
+    double tableVirtualize = NsPerGlyph(stream, options.glyphs, [](const GlyphUse& use) {
+        return (uint32_t)TableVirtualizeGlyphIndex(use.font, use.glyph);
+    });
+
+    std::vector<GlyphUse> virtualStream = stream;
+    for (GlyphUse& use : virtualStream) use.glyph = TableVirtualizeGlyphIndex(use.font, use.glyph);
+    double mapTranslate = NsPerGlyph(virtualStream, options.glyphs, [](const GlyphUse& use) {
+        return (uint32_t)MapTranslateVirtualGlyphIndex(use.font, use.glyph);
+    });
+    double tableTranslate = NsPerGlyph(virtualStream, options.glyphs, [](const GlyphUse& use) {
+        return (uint32_t)TableTranslateVirtualGlyphIndex(use.font, use.glyph);
+    });
+
+    printf("path                 map ns/glyph  table ns/glyph  speedup\n");
+    printf("virtualize (assign)  %12.1f  %14.1f  %6.1fx\n", mapCold, tableCold, mapCold / tableCold);
+    printf("virtualize (known)   %12.1f  %14.1f  %6.1fx\n", mapVirtualize, tableVirtualize,
+        mapVirtualize / tableVirtualize);
+    printf("translate            %12.1f  %14.1f  %6.1fx\n", mapTranslate, tableTranslate,
+        mapTranslate / tableTranslate);
+
+    CheckRuns(stream, options.fonts);
+
+    // Known glyphs only, so neither path takes the lock; the fresh font has no
+    // table, which is every font before its first alias.
+    HFONT freshFont = FontHandle(options.fonts + 1);
+    printf("\nrun     virtualize per/run   translate per/run   no-alias font per/run  (ns/glyph)\n");
+    for (int length : kRunLengths) {
+        double perVirtualize = NsPerRunGlyph(stream, options.fonts, length, options.glyphs / 4, nullptr,
+            PerGlyphVirtualize);
+        double runVirtualize = NsPerRunGlyph(stream, options.fonts, length, options.glyphs / 4, nullptr,
+            RunVirtualize);
+        double perTranslate = NsPerRunGlyph(virtualStream, options.fonts, length, options.glyphs / 4, nullptr,
+            PerGlyphTranslate);
+        double runTranslate = NsPerRunGlyph(virtualStream, options.fonts, length, options.glyphs / 4, nullptr,
+            RunTranslate);
+        double perFresh = NsPerRunGlyph(stream, options.fonts, length, options.glyphs / 4, freshFont,
+            PerGlyphTranslate);
+        double runFresh = NsPerRunGlyph(stream, options.fonts, length, options.glyphs / 4, freshFont,
+            RunTranslate);
+        printf("%4d   %6.1f %5.1f %5.1fx   %6.1f %5.1f %5.1fx   %6.1f %5.1f %6.1fx\n", length,
+            perVirtualize, runVirtualize, perVirtualize / runVirtualize,
+            perTranslate, runTranslate, perTranslate / runTranslate,
+            perFresh, runFresh, perFresh / runFresh);
+    }
+
+    FreeTables();
+    return g_failures ? 1 : 0;
+}
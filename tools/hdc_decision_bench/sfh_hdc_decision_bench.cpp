@@ -0,0 +1,411 @@
+// Hit and miss cost of the per-thread ReplaceHdcFont decision cache.
+//
+//   g++ -std=c++17 -O2 -I tools/win32_compat
+//       -o sfh_hdc_decision_bench tools/hdc_decision_bench/sfh_hdc_decision_bench.cpp
+//   ./sfh_hdc_decision_bench [--calls N] [--dcs N]
+//
+// Two copies of ReplaceHdcFont's decision run over the same DCs: the uncached
+// path the cache replaced (four engine predicates, seven GetStockObject calls,
+// the replacement index lookup and the g_fontCacheMutex lookup on every call)
+// and the cached path built on hdc_decision_cache.h, compiled unchanged.
+// GDI and the engine predicates are user-mode stand-ins that are kept out of
+// line, so the numbers show the hook's own work; a real GetObjectW call costs
+// more than its stand-in and is paid by both paths for untracked fonts.
+// Both paths must select the same font on every call.
+#include "../../SimpleFontHook/hooks/hdc_decision_cache.h"
+#include "../../SimpleFontHook/hooks/replacement_info_index.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    typedef uintptr_t Handle;
+
+    // LOGFONTW's layout with a UTF-16 face name, so the stamp hashes the same
+    // 92 bytes it does on Windows.
+    struct LogFont {
+        LONG height, width, escapement, orientation, weight;
+        BYTE italic, underline, strikeOut, charSet;
+        BYTE outPrecision, clipPrecision, quality, pitchAndFamily;
+        char16_t faceName[32];
+    };
+    static_assert(sizeof(LogFont) == 92, "LOGFONTW is 92 bytes");
+
+    // ReplacementFontInfo: original handle, source LOGFONT, config version.
+    struct ReplacementInfo {
+        Handle originalFont;
+        LogFont sourceLogfont;
+        LONG configVersion;
+    };
+
+    bool SameFace(const char16_t* a, const char16_t* b) {
+        for (size_t i = 0; i < 32; ++i) {
+            if (a[i] != b[i]) return false;
+            if (!a[i]) return true;
+        }
+        return true;
+    }
+
+    bool SameSourceLogFont(const LogFont& a, const LogFont& b) {
+        return a.height == b.height && a.width == b.width && a.escapement == b.escapement &&
+            a.orientation == b.orientation && a.weight == b.weight && a.italic == b.italic &&
+            a.underline == b.underline && a.strikeOut == b.strikeOut && a.charSet == b.charSet &&
+            a.outPrecision == b.outPrecision && a.clipPrecision == b.clipPrecision &&
+            a.quality == b.quality && a.pitchAndFamily == b.pitchAndFamily &&
+            SameFace(a.faceName, b.faceName);
+    }
+
+    // --- GDI and engine stand-ins -------------------------------------------
+
+    const Handle kStockFonts[7] = {
+        0x018A0010, 0x018A0011, 0x018A0012, 0x018A0013, 0x018A0014, 0x018A0015, 0x018A0016,
+    };
+
+    struct Gdi {
+        std::vector<Handle> selected;                   // per DC
+        std::unordered_map<Handle, LogFont> fonts;      // GetObjectW view
+    };
+    Gdi g_gdi;
+
+    Handle DcHandle(size_t index) { return (Handle)(0x01010000u | (uint32_t)(0x200u + index)); }
+    size_t DcIndex(Handle hdc) { return (size_t)((hdc & 0xFFFF) - 0x200u); }
+
+    __attribute__((noinline)) Handle GetCurrentFont(Handle hdc) { return g_gdi.selected[DcIndex(hdc)]; }
+
+    __attribute__((noinline)) Handle GetStockFont(int index) { return kStockFonts[index]; }
+
+    __attribute__((noinline)) bool GetFontObject(Handle font, LogFont* logfont) {
+        auto it = g_gdi.fonts.find(font);
+        if (it == g_gdi.fonts.end()) return false;
+        *logfont = it->second;
+        return true;
+    }
+
+    __attribute__((noinline)) Handle SelectFont(Handle hdc, Handle font) {
+        Handle old = g_gdi.selected[DcIndex(hdc)];
+        g_gdi.selected[DcIndex(hdc)] = font;
+        return old;
+    }
+
+    // Each engine predicate checks its enable flag and a latched runtime probe.
+    volatile LONG g_engineEnabled[4] = { 1, 1, 1, 1 };
+    volatile LONG g_engineProbe[4] = { 0, 0, 0, 0 };
+
+    __attribute__((noinline)) bool EnginePredicate(int engine) {
+        return ReadAcquire(&g_engineEnabled[engine]) && ReadAcquire(&g_engineProbe[engine]) == 1;
+    }
+
+    // --- Replacement state shared by both paths ------------------------------
+
+    volatile LONG g_configVersion = 3;
+    volatile LONG g_observedConfigVersion = 3;
+    volatile LONG g_needFontReload = 0;
+    volatile LONG g_replacementInfoSerial = 0;
+    const char16_t kForcedFace[] = u"Source Han Sans";
+
+    typedef ReplacementInfoIndex::Table<Handle, ReplacementInfo> IndexTable;
+
+    std::mutex g_writerMutex;
+    IndexTable* volatile g_replacementInfo = nullptr;
+    std::vector<IndexTable*> g_retiredReplacementInfo;
+
+    std::mutex g_fontCacheMutex;
+    std::unordered_map<Handle, Handle> g_replacementByOriginal;
+
+    void RegisterReplacement(Handle original, Handle replacement, const LogFont& source) {
+        std::lock_guard<std::mutex> lock(g_writerMutex);
+        std::lock_guard<std::mutex> cacheLock(g_fontCacheMutex);
+        g_replacementByOriginal[original] = replacement;
+        InterlockedIncrement(&g_replacementInfoSerial);
+        ReplacementInfoIndex::StoreLocked(g_replacementInfo, g_retiredReplacementInfo, replacement,
+            ReplacementInfo{ original, source, g_configVersion });
+    }
+
+    bool IsStockFontUncached(Handle font) {
+        static const int stock[] = { 0, 1, 2, 3, 4, 5, 6 };
+        for (int index : stock) {
+            if (font == GetStockFont(index)) return true;
+        }
+        return false;
+    }
+
+    Handle g_capturedStockFonts[7];
+
+    bool IsStockFontCaptured(Handle font) {
+        for (Handle stock : g_capturedStockFonts) {
+            if (font == stock) return true;
+        }
+        return false;
+    }
+
+    // BuildReplacementLogFont's face-name branch plus FindCachedReplacementFont.
+    Handle GetOrCreateReplacementFont(Handle original, const LogFont& source) {
+        if (g_observedConfigVersion != g_configVersion || InterlockedCompareExchange(&g_needFontReload, 0, 0) != 0)
+            return 0;
+        LogFont replacementLogfont = source;
+        if (SameFace(replacementLogfont.faceName, kForcedFace)) return 0;
+        memcpy(replacementLogfont.faceName, kForcedFace, sizeof(kForcedFace));
+
+        std::lock_guard<std::mutex> lock(g_fontCacheMutex);
+        auto byOriginal = g_replacementByOriginal.find(original);
+        if (byOriginal == g_replacementByOriginal.end()) return 0;
+        ReplacementInfo info;
+        if (!ReplacementInfoIndex::Find(g_replacementInfo, byOriginal->second, &info)) return 0;
+        if (info.configVersion != g_configVersion || !SameSourceLogFont(info.sourceLogfont, source)) return 0;
+        return byOriginal->second;
+    }
+
+    // --- The two decision paths ---------------------------------------------
+
+    // ReplaceHdcFont before the cache. Returns the font selected into `hdc`, or 0.
+    Handle ReplaceUncached(Handle hdc) {
+        bool allow = EnginePredicate(0) || EnginePredicate(1) || EnginePredicate(2) || EnginePredicate(3);
+        (void)allow;
+        Handle current = GetCurrentFont(hdc);
+        if (!current || IsStockFontUncached(current)) return 0;
+
+        ReplacementInfo info;
+        LogFont source;
+        Handle original = current;
+        if (ReplacementInfoIndex::Find(g_replacementInfo, current, &info)) {
+            if (info.configVersion == g_configVersion) return 0;
+            source = info.sourceLogfont;
+            original = info.originalFont;
+        } else if (!GetFontObject(current, &source)) {
+            return 0;
+        }
+        Handle replacement = GetOrCreateReplacementFont(original, source);
+        if (!replacement || replacement == current) return 0;
+        SelectFont(hdc, replacement);
+        return replacement;
+    }
+
+    volatile LONG g_policySnapshot = -1;
+
+    bool EngineAllowsCached() {
+        LONG key = g_configVersion << 8;
+        LONG snapshot = ReadAcquire(&g_policySnapshot);
+        if (snapshot != -1 && (snapshot & ~1L) == key) return (snapshot & 1) != 0;
+        bool allow = EnginePredicate(0) || EnginePredicate(1) || EnginePredicate(2) || EnginePredicate(3);
+        InterlockedExchange(&g_policySnapshot, key | (allow ? 1 : 0));
+        return allow;
+    }
+
+    uint64_t SourceStamp(Handle font, LogFont* source) {
+        LogFont logfont;
+        if (!GetFontObject(font, &logfont)) return 0;
+        if (source) *source = logfont;
+        return HdcDecision::Stamp(&logfont, sizeof(logfont));
+    }
+
+    thread_local HdcDecision::Cache g_cache;
+    uint64_t g_cacheHits = 0;
+
+    // ReplaceHdcFont with the per-thread decision cache, as in font_hooks_runtime.
+    Handle ReplaceCached(Handle hdc) {
+        bool allow = EngineAllowsCached();
+        (void)allow;
+        Handle current = GetCurrentFont(hdc);
+        if (!current) return 0;
+
+        LONG version = g_configVersion;
+        LONG serial = ReadAcquire(&g_replacementInfoSerial);
+        const HdcDecision::Entry* decision = HdcDecision::Find(g_cache, hdc, current, version, (uint32_t)serial);
+        if (decision && decision->kind == HdcDecision::Skip) {
+            ++g_cacheHits;
+            return 0;
+        }
+        if (decision && decision->kind == HdcDecision::Replace) {
+            if (!decision->sourceStamp || SourceStamp(current, nullptr) == decision->sourceStamp) {
+                ++g_cacheHits;
+                SelectFont(hdc, decision->replacement);
+                return decision->replacement;
+            }
+            HdcDecision::Forget(g_cache, hdc, current);
+        }
+
+        if (IsStockFontCaptured(current)) {
+            HdcDecision::Claim(g_cache, hdc, current, version, (uint32_t)serial, HdcDecision::Skip);
+            return 0;
+        }
+        ReplacementInfo info;
+        LogFont source;
+        Handle original = current;
+        uint64_t stamp = 0;
+        if (ReplacementInfoIndex::Find(g_replacementInfo, current, &info)) {
+            if (info.configVersion == version) {
+                HdcDecision::Claim(g_cache, hdc, current, version, (uint32_t)serial, HdcDecision::Skip);
+                return 0;
+            }
+            source = info.sourceLogfont;
+            original = info.originalFont;
+        } else if ((stamp = SourceStamp(current, &source)) == 0) {
+            return 0;
+        }
+        Handle replacement = GetOrCreateReplacementFont(original, source);
+        if (!replacement || replacement == current) return 0;
+
+        HdcDecision::Entry& entry = HdcDecision::Claim(g_cache, hdc, current, version,
+            (uint32_t)ReadAcquire(&g_replacementInfoSerial), HdcDecision::Replace);
+        entry.replacement = replacement;
+        entry.original = original;
+        entry.sourceStamp = stamp;
+        entry.sourceHeight = source.height;
+        entry.sourceWeight = source.weight;
+        SelectFont(hdc, replacement);
+        return replacement;
+    }
+
+    // --- Workloads -----------------------------------------------------------
+
+    enum class Workload { Current, Stock, Untracked, Miss };
+
+    const char* WorkloadName(Workload workload) {
+        switch (workload) {
+        case Workload::Current: return "current";
+        case Workload::Stock: return "stock";
+        case Workload::Untracked: return "untracked";
+        case Workload::Miss: return "miss";
+        }
+        return "?";
+    }
+
+    LogFont MakeLogFont(uint32_t index) {
+        LogFont logfont = {};
+        logfont.height = -(int32_t)(16 + index % 24);
+        logfont.weight = index & 1 ? 700 : 400;
+        logfont.charSet = 128;
+        const char16_t face[] = u"MS Gothic";
+        memcpy(logfont.faceName, face, sizeof(face));
+        return logfont;
+    }
+
+    // Each DC gets its own source font. `current` DCs hold the registered
+    // replacement, `stock` DCs a stock font, `untracked` and `miss` DCs a font
+    // the creation hooks never saw, whose replacement is already registered.
+    std::vector<Handle> SetUpDcs(Workload workload, uint32_t dcs) {
+        g_gdi = Gdi();
+        g_replacementByOriginal.clear();
+        g_cache = HdcDecision::Cache();
+        std::vector<Handle> initial(dcs);
+        for (uint32_t i = 0; i < dcs; ++i) {
+            Handle source = (Handle)(0x0A100000u | (0x400u + i));
+            Handle replacement = (Handle)(0x0A200000u | (0x400u + i));
+            LogFont logfont = MakeLogFont(i);
+            g_gdi.fonts[source] = logfont;
+            RegisterReplacement(source, replacement, logfont);
+            if (workload == Workload::Current) initial[i] = replacement;
+            else if (workload == Workload::Stock) initial[i] = kStockFonts[i % 7];
+            else initial[i] = source;
+        }
+        g_gdi.selected = initial;
+        return initial;
+    }
+
+    struct Timing {
+        double nsPerCall = 0;
+        uint64_t checksum = 0;
+        std::vector<Handle> selections;
+    };
+
+    // One draw per call: decide, then RestoreHdcFont's reselect of the source
+    // font. `Miss` moves the registration serial before every draw, which is
+    // the cached path's worst case.
+    template <typename Decide>
+    Timing Measure(Workload workload, const std::vector<Handle>& initial, uint32_t calls, bool record, Decide decide) {
+        Timing timing;
+        if (record) timing.selections.reserve(calls);
+        uint32_t dcs = (uint32_t)initial.size();
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < calls; ++i) {
+            uint32_t dc = i % dcs;
+            if (workload == Workload::Miss) InterlockedIncrement(&g_replacementInfoSerial);
+            Handle selected = decide(DcHandle(dc));
+            if (selected) SelectFont(DcHandle(dc), initial[dc]);
+            timing.checksum += selected;
+            if (record) timing.selections.push_back(selected);
+        }
+        auto end = std::chrono::steady_clock::now();
+        timing.nsPerCall = std::chrono::duration<double, std::nano>(end - start).count() / calls;
+        return timing;
+    }
+
+    void FreeIndex() {
+        IndexTable* current = g_replacementInfo;
+        g_retiredReplacementInfo.push_back(current);
+        for (IndexTable* table : g_retiredReplacementInfo) {
+            delete[] table->slots;
+            delete table;
+        }
+        g_retiredReplacementInfo.clear();
+        g_replacementInfo = nullptr;
+    }
+
+    struct Options {
+        uint32_t calls = 2000000;
+        uint32_t dcs = 4;
+    };
+
+    bool ParseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 < argc && arg == "--calls") {
+                options.calls = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            } else if (i + 1 < argc && arg == "--dcs") {
+                options.dcs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            } else {
+                return false;
+            }
+        }
+        return options.calls > 0 && options.dcs > 0 && options.dcs <= 4096;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--calls N] [--dcs N]\n", argv[0]);
+        return 2;
+    }
+    g_replacementInfo = ReplacementInfoIndex::Create<Handle, ReplacementInfo>(64);
+    for (size_t i = 0; i < 7; ++i) g_capturedStockFonts[i] = GetStockFont((int)i);
+
+    printf("%-10s %12s %12s %8s %8s\n", "workload", "uncached-ns", "cached-ns", "speedup", "hit%");
+    bool ok = true;
+    const Workload workloads[] = { Workload::Current, Workload::Stock, Workload::Untracked, Workload::Miss };
+    for (Workload workload : workloads) {
+        // A short recorded pass checks that both paths select the same fonts,
+        // then the timed passes run without recording.
+        uint32_t checkCalls = options.calls < 4096 ? options.calls : 4096;
+        std::vector<Handle> initial = SetUpDcs(workload, options.dcs);
+        Timing expected = Measure(workload, initial, checkCalls, true, ReplaceUncached);
+        initial = SetUpDcs(workload, options.dcs);
+        Timing actual = Measure(workload, initial, checkCalls, true, ReplaceCached);
+        if (expected.selections != actual.selections) {
+            printf("FAIL %s: cached path selected different fonts\n", WorkloadName(workload));
+            ok = false;
+        }
+
+        initial = SetUpDcs(workload, options.dcs);
+        Timing uncached = Measure(workload, initial, options.calls, false, ReplaceUncached);
+        initial = SetUpDcs(workload, options.dcs);
+        g_cacheHits = 0;
+        Timing cached = Measure(workload, initial, options.calls, false, ReplaceCached);
+        if (uncached.checksum != cached.checksum) {
+            printf("FAIL %s: checksum mismatch\n", WorkloadName(workload));
+            ok = false;
+        }
+        printf("%-10s %12.1f %12.1f %7.2fx %7.1f%%\n", WorkloadName(workload), uncached.nsPerCall,
+            cached.nsPerCall, uncached.nsPerCall / cached.nsPerCall, 100.0 * g_cacheHits / options.calls);
+    }
+    FreeIndex();
+    return ok ? 0 : 1;
+}
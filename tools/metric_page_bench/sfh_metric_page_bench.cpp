@@ -0,0 +1,195 @@
+// Fill and lookup cost of the per-font character metric pages.
+//
+//   g++ -std=c++17 -O2 -I tools/win32_compat
+//       -o sfh_metric_page_bench tools/metric_page_bench/sfh_metric_page_bench.cpp
+//   ./sfh_metric_page_bench [--chars N] [--spacing N]
+//
+// MetricPages (the DLL header, compiled unchanged) is driven the way
+// TryGetCachedCharMetrics drives it: every lookup takes a mutex, a missing page
+// is measured once, adjusted for character spacing and stored. The text is a
+// synthetic Japanese script queried one character at a time, as BGI, Majiro
+// and Softpal measure before drawing. The GDI measurement is a stand-in that
+// derives values from the code point, so the fill numbers cover the page
+// allocation and copy only; on Windows each fill also pays one GDI call.
+// Every returned value must equal the stand-in's answer plus the spacing.
+#include "../../SimpleFontHook/hooks/metric_page_set.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+    struct Abc {
+        int a;
+        unsigned b;
+        int c;
+    };
+
+    // Deterministic per-code-point metrics in place of GetCharWidth32W and
+    // GetCharABCWidthsW.
+    int WidthOf(uint32_t code) { return code < 0x3000 ? 8 + (int)(code % 5) : 16 + (int)(code % 3); }
+    Abc AbcOf(uint32_t code) { return Abc{ (int)(code % 3) - 1, (unsigned)WidthOf(code), (int)(code % 2) }; }
+
+    __attribute__((noinline)) void MeasurePage(uint32_t first, int* values) {
+        for (uint32_t i = 0; i < MetricPages::kPageSize; ++i) values[i] = WidthOf(first + i);
+    }
+
+    __attribute__((noinline)) void MeasurePage(uint32_t first, Abc* values) {
+        for (uint32_t i = 0; i < MetricPages::kPageSize; ++i) values[i] = AbcOf(first + i);
+    }
+
+    int g_spacing = 2;
+
+    void AdjustPage(int* values) {
+        for (uint32_t i = 0; i < MetricPages::kPageSize; ++i) values[i] += g_spacing;
+    }
+
+    void AdjustPage(Abc* values) {
+        for (uint32_t i = 0; i < MetricPages::kPageSize; ++i) values[i].b += (unsigned)g_spacing;
+    }
+
+    bool Expected(uint32_t code, const int& value) { return value == WidthOf(code) + g_spacing; }
+
+    bool Expected(uint32_t code, const Abc& value) {
+        Abc raw = AbcOf(code);
+        return value.a == raw.a && value.b == raw.b + (unsigned)g_spacing && value.c == raw.c;
+    }
+
+    struct Counters {
+        uint64_t fills = 0;
+        double fillNs = 0;
+    };
+
+    std::mutex g_metricMutex;
+
+    // TryGetCachedCharMetrics without the HDC and record lookups.
+    template <typename T>
+    bool CachedLookup(MetricPages::Set<T>& set, uint32_t first, uint32_t last, T* out, Counters& counters) {
+        for (;;) {
+            uint32_t missing;
+            {
+                std::lock_guard<std::mutex> lock(g_metricMutex);
+                if (MetricPages::Read(set, first, last, out)) return true;
+                missing = MetricPages::FindMissing(set, first, last);
+            }
+            auto start = std::chrono::steady_clock::now();
+            T values[MetricPages::kPageSize];
+            MeasurePage(missing << MetricPages::kPageShift, values);
+            AdjustPage(values);
+            std::lock_guard<std::mutex> lock(g_metricMutex);
+            MetricPages::Store(set, missing, values);
+            auto end = std::chrono::steady_clock::now();
+            ++counters.fills;
+            counters.fillNs += std::chrono::duration<double, std::nano>(end - start).count();
+        }
+    }
+
+    // Hiragana, katakana, CJK punctuation, ASCII and kanji drawn from a skewed
+    // distribution over 0x4E00-0x9FFF, so a few hundred kanji dominate.
+    std::vector<uint16_t> BuildScript(size_t count) {
+        std::vector<uint16_t> text(count);
+        uint32_t state = 0x9E3779B9u;
+        for (uint16_t& ch : text) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            uint32_t pick = state % 100;
+            uint32_t value = state >> 8;
+            if (pick < 40) ch = (uint16_t)(0x3041 + value % 86);
+            else if (pick < 55) ch = (uint16_t)(0x30A1 + value % 90);
+            else if (pick < 62) ch = (uint16_t)(0x3001 + value % 20);
+            else if (pick < 67) ch = (uint16_t)(0x20 + value % 95);
+            else {
+                uint32_t rank = (value % 1024) * (value % 1024) / 1024 * (value % 20 + 1);
+                ch = (uint16_t)(0x4E00 + rank % 0x5200);
+            }
+        }
+        return text;
+    }
+
+    template <typename T>
+    struct Result {
+        double lookupNs = 0;
+        double rangeNs = 0;
+        Counters counters;
+        uint64_t mismatches = 0;
+        size_t pages = 0;
+    };
+
+    template <typename T>
+    Result<T> Run(const std::vector<uint16_t>& script) {
+        Result<T> result;
+        MetricPages::Set<T> set = {};
+        T value;
+
+        // First pass fills every page the script touches; the timed pass then
+        // reads them one character at a time.
+        for (uint16_t ch : script) {
+            if (!CachedLookup(set, ch, ch, &value, result.counters) || !Expected(ch, value)) ++result.mismatches;
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (uint16_t ch : script) {
+            CachedLookup(set, ch, ch, &value, result.counters);
+            if (!Expected(ch, value)) ++result.mismatches;
+        }
+        auto end = std::chrono::steady_clock::now();
+        result.lookupNs = std::chrono::duration<double, std::nano>(end - start).count() / script.size();
+
+        // The 0x20-0x7E table engines build at load time, as one range query.
+        T ascii[95];
+        CachedLookup(set, 0x20, 0x7E, ascii, result.counters);
+        const int rangeRounds = 200000;
+        start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rangeRounds; ++round) CachedLookup(set, 0x20, 0x7E, ascii, result.counters);
+        end = std::chrono::steady_clock::now();
+        result.rangeNs = std::chrono::duration<double, std::nano>(end - start).count() / rangeRounds;
+        for (uint32_t code = 0x20; code <= 0x7E; ++code) {
+            if (!Expected(code, ascii[code - 0x20])) ++result.mismatches;
+        }
+
+        for (const auto& page : set.pages) {
+            if (page) ++result.pages;
+        }
+        return result;
+    }
+
+    template <typename T>
+    bool Report(const char* name, const Result<T>& result) {
+        printf("%-5s pages=%-4zu fill=%7.0f ns/page  char=%6.1f ns  ascii-range=%7.1f ns  (%.1f KB)\n",
+            name, result.pages, result.counters.fills ? result.counters.fillNs / result.counters.fills : 0.0,
+            result.lookupNs, result.rangeNs, result.pages * MetricPages::kPageSize * sizeof(T) / 1024.0);
+        if (result.mismatches) {
+            printf("FAIL %s: %llu values differ from the measured page\n", name,
+                (unsigned long long)result.mismatches);
+            return false;
+        }
+        return true;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t chars = 2000000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--chars") {
+            chars = (size_t)strtoull(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && arg == "--spacing") {
+            g_spacing = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--chars N] [--spacing N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (chars == 0) chars = 1;
+
+    std::vector<uint16_t> script = BuildScript(chars);
+    printf("chars=%zu spacing=%d\n", chars, g_spacing);
+    bool ok = Report("width", Run<int>(script));
+    ok = Report("abc", Run<Abc>(script)) && ok;
+    return ok ? 0 : 1;
+}
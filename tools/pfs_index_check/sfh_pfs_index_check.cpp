@@ -0,0 +1,489 @@
+// Fuzz check and benchmark for the Artemis PFS index core and pf8 decryption.
+//
+//   g++ -std=c++17 -O2
+//       -o sfh_pfs_index_check tools/pfs_index_check/sfh_pfs_index_check.cpp
+//   ./sfh_pfs_index_check [--entries N] [--fuzz N] [--lookups N] [--seed N]
+//
+// artemis_pfs_index.cppinc is compiled unchanged. Synthetic pf2/pf6/pf8 and
+// headerless archives are built in memory; the hashed index must answer every
+// lookup the way a linear walk over the same bytes does (the walk the DLL ran
+// per lookup before the index existed). The fuzz pass mutates, truncates and
+// corrupts small archives and repeats the comparison; build it with
+// -fsanitize=address,undefined to catch out-of-range reads. The benchmark
+// times index construction and hit/miss lookups on a --entries archive
+// against the linear walk.
+//
+// ArtemisXorPfsRange is checked against the byte-at-a-time key loop at every
+// key phase, and range-by-range decryption (as ArtemisReadPfsResource does it)
+// against whole-buffer decryption. Its throughput is reported in GB/s for a
+// cache-resident 64 KB range and a 16 MB resource.
+#include <cstddef>
+#include <cstdint>
+#include <emmintrin.h>
+#include <vector>
+
+#include "../../SimpleFontHook/hooks/internal/engines/artemis/artemis_pfs_index.cppinc"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+    int g_failures = 0;
+    int g_checks = 0;
+
+    void Check(bool condition, const std::string& where, const char* what) {
+        ++g_checks;
+        if (condition) return;
+        ++g_failures;
+        if (g_failures <= 20) printf("FAIL %s: %s\n", where.c_str(), what);
+    }
+
+    struct Random {
+        uint32_t state;
+        uint32_t Next() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+    };
+
+    void PutLe32(std::vector<uint8_t>& bytes, size_t pos, uint32_t value) {
+        bytes[pos + 0] = (uint8_t)value;
+        bytes[pos + 1] = (uint8_t)(value >> 8);
+        bytes[pos + 2] = (uint8_t)(value >> 16);
+        bytes[pos + 3] = (uint8_t)(value >> 24);
+    }
+
+    void AppendLe32(std::vector<uint8_t>& bytes, uint32_t value) {
+        bytes.resize(bytes.size() + 4);
+        PutLe32(bytes, bytes.size() - 4, value);
+    }
+
+    // Only the header and index are materialized; resource data lives past
+    // `bytes` in a virtual archive of `archiveSize` bytes.
+    struct Archive {
+        std::vector<uint8_t> bytes;
+        uint64_t archiveSize;
+        std::vector<std::string> names;
+        char version;                   // '2', '6', '8' or 0 for headerless
+    };
+
+    std::string MakeName(Random& random, uint32_t index) {
+        static const char* const kFolders[] = {
+            "system\\table\\", "system/script/", "_base\\", "image\\ev\\", "image/bg/",
+            "sound\\voice\\", "font\\", "movie\\",
+        };
+        static const char* const kExtensions[] = { ".tbl", ".iet", ".png", ".ogg", ".ttf", ".ast", ".lua" };
+        std::string name = kFolders[random.Next() % 8];
+        char stem[32];
+        snprintf(stem, sizeof(stem), "%s%06u_%02u", random.Next() % 3 ? "res" : "RES", index, random.Next() % 100);
+        name += stem;
+        name += kExtensions[random.Next() % 7];
+        return name;
+    }
+
+    // Every 997th entry repeats an earlier name; every 1009th points past the
+    // end of the archive and must never be found.
+    Archive BuildArchive(char version, uint32_t count, uint32_t seed) {
+        Archive archive;
+        archive.version = version;
+        Random random = { seed * 0x9E3779B9u + 1 };
+        for (uint32_t i = 0; i < count; ++i) {
+            if (i > 0 && i % 997 == 0) {
+                archive.names.push_back(archive.names[random.Next() % i]);
+            } else {
+                archive.names.push_back(MakeName(random, i));
+            }
+        }
+
+        const bool headerless = version == 0;
+        const uint32_t trailerSize = headerless ? 12 : 20;
+        const uint32_t offsetField = headerless ? 4 : 12;
+        const uint32_t sizeField = headerless ? 8 : 16;
+
+        std::vector<uint8_t>& bytes = archive.bytes;
+        if (headerless) {
+            AppendLe32(bytes, count);
+        } else {
+            bytes = { 'p', 'f', (uint8_t)version };
+            AppendLe32(bytes, 0);       // index size, patched below
+            AppendLe32(bytes, 0);       // reserved
+            AppendLe32(bytes, count);
+        }
+
+        size_t indexBytes = 0;
+        for (const std::string& name : archive.names) indexBytes += 4 + name.size() + trailerSize;
+        uint64_t dataStart = bytes.size() + indexBytes + 64;
+        uint64_t nextData = dataStart;
+        std::vector<std::pair<uint32_t, uint32_t>> spans;
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t size = 1 + random.Next() % 20000;
+            spans.emplace_back((uint32_t)nextData, size);
+            nextData += size;
+        }
+        archive.archiveSize = nextData;
+        for (uint32_t i = 1009; i < count; i += 1009) spans[i].first = (uint32_t)(archive.archiveSize - 10);
+
+        for (uint32_t i = 0; i < count; ++i) {
+            const std::string& name = archive.names[i];
+            AppendLe32(bytes, (uint32_t)name.size());
+            bytes.insert(bytes.end(), name.begin(), name.end());
+            size_t trailer = bytes.size();
+            bytes.resize(bytes.size() + trailerSize, 0);
+            PutLe32(bytes, trailer + offsetField, spans[i].first);
+            PutLe32(bytes, trailer + sizeField, spans[i].second);
+        }
+        // pf8 archives follow the entries with an offset table; headerless
+        // walks need zero padding to stop before the data.
+        bytes.resize(bytes.size() + 64, 0);
+        if (!headerless) PutLe32(bytes, 3, (uint32_t)(bytes.size() - 7));
+        return archive;
+    }
+
+    // --- The index as the DLL builds it. ---
+
+    struct Parsed {
+        ArtemisPfsHeaderInfo layout;
+        bool parsedHeader;
+        uint64_t viewSize;
+        ArtemisPfsIndex index;
+    };
+
+    // Mirrors ArtemisMapPfsIndexLocked: a parsed header maps just the index;
+    // otherwise the whole (capped) archive is scanned with the legacy layout.
+    void ParseArchive(const std::vector<uint8_t>& bytes, uint64_t archiveSize, Parsed& parsed) {
+        parsed.layout = {};
+        parsed.parsedHeader = ArtemisPfsParseHeader(bytes.data(), bytes.size(), parsed.layout);
+        if (parsed.parsedHeader) {
+            parsed.viewSize = parsed.layout.indexStart + parsed.layout.indexSize;
+        } else {
+            parsed.viewSize = bytes.size();
+            parsed.layout.entryStart = ArtemisPfsDetectIndexStart(bytes.data(), bytes.size());
+            parsed.layout.trailerSize = 12;
+            parsed.layout.offsetField = 4;
+            parsed.layout.sizeField = 8;
+        }
+        ArtemisPfsBuildIndex(bytes.data(), parsed.viewSize, archiveSize, parsed.layout, parsed.parsedHeader,
+            parsed.index);
+    }
+
+    std::string Normalize(const std::string& name) {
+        std::string out = name;
+        for (char& ch : out) ch = (char)ArtemisPfsNormalizeNameByte((uint8_t)ch);
+        return out;
+    }
+
+    // --- The linear walk: reference answer and benchmark baseline. ---
+
+    struct Found {
+        bool found;
+        uint32_t dataOffset;
+        uint32_t dataSize;
+    };
+
+    Found LinearFind(const std::vector<uint8_t>& bytes, const Parsed& parsed, uint64_t archiveSize,
+        const std::string& normalized) {
+        const ArtemisPfsHeaderInfo& layout = parsed.layout;
+        uint64_t pos = layout.entryStart;
+        uint64_t end = parsed.parsedHeader ? layout.indexStart + layout.indexSize : parsed.viewSize;
+        if (end > parsed.viewSize) end = parsed.viewSize;
+        uint64_t minDataOffset = archiveSize;
+        uint32_t parsedCount = 0;
+
+        while (pos + 4 + layout.trailerSize < end && pos + 4 + layout.trailerSize < minDataOffset) {
+            uint32_t nameLen = ArtemisPfsReadLe32(bytes.data() + pos);
+            pos += 4;
+            if (nameLen == 0 || nameLen > 512 || pos + nameLen + layout.trailerSize > end) break;
+
+            const uint8_t* trailer = bytes.data() + pos + nameLen;
+            uint32_t offset = ArtemisPfsReadLe32(trailer + layout.offsetField);
+            uint32_t size = ArtemisPfsReadLe32(trailer + layout.sizeField);
+            if (offset > 0 && offset < minDataOffset) minDataOffset = offset;
+
+            std::string name = Normalize(std::string((const char*)bytes.data() + pos, nameLen));
+            if (name == normalized && (uint64_t)offset + size <= archiveSize) return { true, offset, size };
+
+            pos += nameLen + layout.trailerSize;
+            if (parsed.parsedHeader && ++parsedCount >= layout.fileCount) break;
+        }
+        return { false, 0, 0 };
+    }
+
+    void CheckLookup(const std::vector<uint8_t>& bytes, const Parsed& parsed, uint64_t archiveSize,
+        const std::string& name, const std::string& where) {
+        std::string normalized = Normalize(name);
+        const ArtemisPfsIndexEntry* entry = ArtemisPfsFindEntry(bytes.data(), parsed.index,
+            (const uint8_t*)normalized.data(), normalized.size());
+        Found expected = LinearFind(bytes, parsed, archiveSize, normalized);
+        Check((entry != nullptr) == expected.found, where + " '" + name + "'", "hit differs from the linear walk");
+        if (!entry || !expected.found) return;
+        Check(entry->dataOffset == expected.dataOffset && entry->dataSize == expected.dataSize,
+            where + " '" + name + "'", "entry differs from the linear walk");
+        Check((uint64_t)entry->nameOffset + entry->nameLength <= parsed.viewSize, where, "name outside the view");
+        Check((uint64_t)entry->dataOffset + entry->dataSize <= archiveSize, where, "data outside the archive");
+    }
+
+    // --- Checks. ---
+
+    void CheckArchive(const Archive& archive, const std::string& where) {
+        Parsed parsed;
+        ParseArchive(archive.bytes, archive.archiveSize, parsed);
+        Check(parsed.parsedHeader == (archive.version != 0), where, "header parse result");
+        Check(parsed.index.parsedCount == archive.names.size(), where, "not every entry parsed");
+        Check(!parsed.parsedHeader || parsed.index.complete, where, "index not complete");
+
+        // The linear walk is O(entries) per lookup, so large archives are sampled.
+        Random random = { 7 };
+        size_t stride = archive.names.size() / 500 + 1;
+        for (size_t i = random.Next() % stride; i < archive.names.size(); i += stride) {
+            std::string name = archive.names[i];
+            // Lookups arrive in any case and with either separator.
+            if (random.Next() % 2) {
+                for (char& ch : name) {
+                    if (ch >= 'a' && ch <= 'z' && random.Next() % 2) ch = (char)(ch - 'a' + 'A');
+                    if (ch == '\\' && random.Next() % 2) ch = '/';
+                }
+            }
+            CheckLookup(archive.bytes, parsed, archive.archiveSize, name, where);
+        }
+        CheckLookup(archive.bytes, parsed, archive.archiveSize, "system\\table\\missing.tbl", where);
+        CheckLookup(archive.bytes, parsed, archive.archiveSize, archive.names[0] + "x", where);
+    }
+
+    void Mutate(Random& random, std::vector<uint8_t>& bytes) {
+        switch (random.Next() % 6) {
+        case 0:     // flip bytes anywhere
+            for (uint32_t i = 0, n = 1 + random.Next() % 8; i < n; ++i)
+                bytes[random.Next() % bytes.size()] ^= (uint8_t)(1 + random.Next() % 255);
+            break;
+        case 1:     // truncate
+            bytes.resize(random.Next() % bytes.size());
+            break;
+        case 2:     // corrupt the header's size and count fields
+            if (bytes.size() >= 15) PutLe32(bytes, random.Next() % 2 ? 3 : 11, random.Next() % 3 ? random.Next() % 4096 : random.Next());
+            break;
+        case 3:     // oversized or zero name length somewhere in the index
+            if (bytes.size() >= 4) PutLe32(bytes, random.Next() % (bytes.size() - 3), random.Next() % 2 ? 0 : 0xFFFFu + random.Next() % 1000);
+            break;
+        case 4:     // data offsets pulled into the index
+            if (bytes.size() >= 4) PutLe32(bytes, random.Next() % (bytes.size() - 3), 16 + random.Next() % 512);
+            break;
+        default:    // random garbage tail
+            for (uint32_t i = 0, n = random.Next() % 64; i < n; ++i) bytes.push_back((uint8_t)random.Next());
+            break;
+        }
+    }
+
+    void Fuzz(uint32_t iterations, uint32_t seed) {
+        static const char kVersions[] = { '2', '6', '8', 0 };
+        Random random = { seed | 1 };
+        for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+            char version = kVersions[random.Next() % 4];
+            Archive archive = BuildArchive(version, 4 + random.Next() % 60, random.Next());
+            for (uint32_t i = 0, n = 1 + random.Next() % 4; i < n && !archive.bytes.empty(); ++i)
+                Mutate(random, archive.bytes);
+            if (random.Next() % 4 == 0) archive.archiveSize = random.Next() % (archive.archiveSize + 1);
+
+            // Exact-size copy so ASan sees reads past the end.
+            std::vector<uint8_t> bytes(archive.bytes.begin(), archive.bytes.end());
+            bytes.shrink_to_fit();
+            Parsed parsed;
+            ParseArchive(bytes, archive.archiveSize, parsed);
+            if (parsed.viewSize > bytes.size()) {
+                Check(false, "fuzz " + std::to_string(iteration), "accepted header maps past the archive");
+                continue;
+            }
+            std::string where = "fuzz " + std::to_string(iteration);
+            for (const std::string& name : archive.names) CheckLookup(bytes, parsed, archive.archiveSize, name, where);
+        }
+    }
+
+    // --- Benchmark. ---
+
+    void Benchmark(uint32_t entries, uint32_t lookups) {
+        Archive archive = BuildArchive('8', entries, 1);
+        printf("pf8 archive: %u entries, %.1f MB index\n", entries, archive.bytes.size() / 1048576.0);
+
+        Parsed parsed;
+        auto start = std::chrono::steady_clock::now();
+        const int builds = 5;
+        for (int i = 0; i < builds; ++i) ParseArchive(archive.bytes, archive.archiveSize, parsed);
+        double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / builds;
+        size_t indexMemory = parsed.index.entries.capacity() * sizeof(ArtemisPfsIndexEntry) +
+            parsed.index.buckets.capacity() * sizeof(uint32_t);
+        printf("index build   %9.2f ms  (%.1f MB of entries and buckets)\n", buildMs, indexMemory / 1048576.0);
+
+        std::vector<std::string> hits;
+        std::vector<std::string> misses;
+        Random random = { 99 };
+        for (uint32_t i = 0; i < 4096; ++i) {
+            hits.push_back(Normalize(archive.names[random.Next() % entries]));
+            misses.push_back(Normalize(MakeName(random, entries + i)));
+        }
+
+        auto hashed = [&](const std::vector<std::string>& names, uint32_t count) {
+            size_t found = 0;
+            auto begin = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < count; ++i) {
+                const std::string& name = names[i & 4095];
+                found += ArtemisPfsFindEntry(archive.bytes.data(), parsed.index, (const uint8_t*)name.data(),
+                    name.size()) != nullptr;
+            }
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / count;
+            if (found == 0xFFFFFFFFu) printf("(sink)\n");
+            return ns;
+        };
+        auto linear = [&](const std::vector<std::string>& names, uint32_t count) {
+            size_t found = 0;
+            auto begin = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < count; ++i)
+                found += LinearFind(archive.bytes, parsed, archive.archiveSize, names[i & 4095]).found;
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / count;
+            if (found == 0xFFFFFFFFu) printf("(sink)\n");
+            return ns;
+        };
+
+        uint32_t linearLookups = std::max<uint32_t>(1, std::min<uint32_t>(lookups, 20000000u / entries));
+        double hashedHit = hashed(hits, lookups);
+        double hashedMiss = hashed(misses, lookups);
+        double linearHit = linear(hits, linearLookups);
+        double linearMiss = linear(misses, linearLookups);
+        printf("lookup        hashed ns  linear ns  speedup\n");
+        printf("hit           %9.1f  %9.0f  %7.0fx\n", hashedHit, linearHit, linearHit / hashedHit);
+        printf("miss          %9.1f  %9.0f  %7.0fx\n", hashedMiss, linearMiss, linearMiss / hashedMiss);
+        printf("index build costs %.2f linear hit lookups\n", buildMs * 1e6 / linearHit);
+    }
+
+    // --- pf8 decryption. ---
+
+    // The loop ArtemisXorPfsRange replaced.
+    void ScalarXor(uint8_t* data, size_t size, uint64_t resourceOffset, const uint8_t key[20]) {
+        for (size_t i = 0; i < size; ++i) data[i] ^= key[(resourceOffset + i) % 20];
+    }
+
+    void CheckXor(uint32_t seed) {
+        Random random = { seed * 31u + 5 };
+        uint8_t key[20];
+        for (uint8_t& byte : key) byte = (uint8_t)random.Next();
+
+        std::vector<uint8_t> source(70000);
+        for (uint8_t& byte : source) byte = (uint8_t)random.Next();
+
+        // Every phase, sizes around the 80-byte block, and unaligned starts.
+        for (uint64_t offset = 0; offset < 40; ++offset) {
+            for (size_t size : { 0, 1, 19, 20, 79, 80, 81, 159, 160, 161, 333, 4096, 65536 + 7 }) {
+                size_t start = (size_t)(offset * 13 % 16);
+                std::vector<uint8_t> expected(source.begin() + start, source.begin() + start + size);
+                std::vector<uint8_t> actual = expected;
+                ScalarXor(expected.data(), size, offset, key);
+                ArtemisXorPfsRange(actual.data(), size, offset, key);
+                Check(expected == actual, "xor offset " + std::to_string(offset) + " size " + std::to_string(size),
+                    "differs from the byte loop");
+            }
+        }
+
+        // Range-by-range decryption with ranges that do not line up with the key.
+        std::vector<uint8_t> whole = source;
+        ArtemisXorPfsRange(whole.data(), whole.size(), 0, key);
+        for (size_t chunk : { 1000, 4096, 65536, 65537 }) {
+            std::vector<uint8_t> ranged = source;
+            for (size_t offset = 0; offset < ranged.size(); offset += chunk) {
+                size_t length = std::min(chunk, ranged.size() - offset);
+                ArtemisXorPfsRange(ranged.data() + offset, length, offset, key);
+            }
+            Check(ranged == whole, "xor ranges of " + std::to_string(chunk), "differs from whole-buffer decryption");
+        }
+    }
+
+    template <typename Step>
+    double GigabytesPerSecond(size_t bytesPerStep, Step step) {
+        size_t steps = std::max<size_t>(4, ((size_t)1 << 28) / bytesPerStep);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < steps; ++i) step(i);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return (double)bytesPerStep * steps / seconds / 1e9;
+    }
+
+    void BenchmarkXor() {
+        uint8_t key[20];
+        for (int i = 0; i < 20; ++i) key[i] = (uint8_t)(i * 37 + 11);
+        const size_t kRange = 64 * 1024;
+        const size_t kResource = 16 * 1024 * 1024;
+        std::vector<uint8_t> stored(kResource, 0x5A);
+        std::vector<uint8_t> plain(kResource);
+
+        printf("pf8 xor                     byte loop GB/s  ArtemisXorPfsRange GB/s  speedup\n");
+        double scalarRange = GigabytesPerSecond(kRange, [&](size_t i) {
+            ScalarXor(plain.data(), kRange, i * kRange, key);
+        });
+        double simdRange = GigabytesPerSecond(kRange, [&](size_t i) {
+            ArtemisXorPfsRange(plain.data(), kRange, i * kRange, key);
+        });
+        printf("64 KB range (in cache)      %14.2f  %23.2f  %6.1fx\n", scalarRange, simdRange, simdRange / scalarRange);
+        double scalarWhole = GigabytesPerSecond(kResource, [&](size_t) {
+            ScalarXor(plain.data(), kResource, 0, key);
+        });
+        double simdWhole = GigabytesPerSecond(kResource, [&](size_t) {
+            ArtemisXorPfsRange(plain.data(), kResource, 0, key);
+        });
+        printf("16 MB resource              %14.2f  %23.2f  %6.1fx\n", scalarWhole, simdWhole, simdWhole / scalarWhole);
+
+        // Copy out of the stored bytes and decrypt: whole buffer, then per range.
+        double copyThenXor = GigabytesPerSecond(kResource, [&](size_t) {
+            memcpy(plain.data(), stored.data(), kResource);
+            ArtemisXorPfsRange(plain.data(), kResource, 0, key);
+        });
+        double rangeByRange = GigabytesPerSecond(kResource, [&](size_t) {
+            for (size_t offset = 0; offset < kResource; offset += kRange) {
+                memcpy(plain.data() + offset, stored.data() + offset, kRange);
+                ArtemisXorPfsRange(plain.data() + offset, kRange, offset, key);
+            }
+        });
+        printf("16 MB copy + decrypt        whole %8.2f  per 64 KB range %7.2f  %6.2fx\n", copyThenXor,
+            rangeByRange, rangeByRange / copyThenXor);
+        if (plain[0] == 0xFF && plain[1] == 0xFF) printf("(sink)\n");
+    }
+
+    bool ParseOptions(int argc, char** argv, uint32_t& entries, uint32_t& fuzz, uint32_t& lookups, uint32_t& seed) {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            std::string arg = argv[i];
+            uint32_t value = (uint32_t)strtoul(argv[i + 1], nullptr, 10);
+            if (arg == "--entries") entries = value;
+            else if (arg == "--fuzz") fuzz = value;
+            else if (arg == "--lookups") lookups = value;
+            else if (arg == "--seed") seed = value;
+            else return false;
+        }
+        return argc % 2 == 1 && entries >= 16 && entries <= 1024 * 1024 && lookups > 0;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t entries = 100000;
+    uint32_t fuzz = 3000;
+    uint32_t lookups = 2000000;
+    uint32_t seed = 1;
+    if (!ParseOptions(argc, argv, entries, fuzz, lookups, seed)) {
+        fprintf(stderr, "usage: sfh_pfs_index_check [--entries N] [--fuzz N] [--lookups N] [--seed N]\n");
+        return 2;
+    }
+
+    CheckArchive(BuildArchive('8', entries, seed), "pf8");
+    CheckArchive(BuildArchive('6', 5000, seed + 1), "pf6");
+    CheckArchive(BuildArchive('2', 5000, seed + 2), "pf2");
+    CheckArchive(BuildArchive(0, 5000, seed + 3), "headerless");
+    Fuzz(fuzz, seed);
+    CheckXor(seed);
+    printf("%d checks, %d failed\n", g_checks, g_failures);
+
+    Benchmark(entries, lookups);
+    BenchmarkXor();
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,246 @@
+// Read-path benchmark for the lock-free replacement font index.
+//
+//   g++ -std=c++17 -O2 -pthread -I tools/win32_compat
+//       -o sfh_replacement_index_bench tools/replacement_index_bench/sfh_replacement_index_bench.cpp
+//   ./sfh_replacement_index_bench [--fonts N] [--lookups N] [--miss PERCENT] [--writer]
+//
+// ReplacementInfoIndex (the DLL header, compiled unchanged) is measured against
+// the baseline it replaced: one std::mutex around an unordered_map, taken for
+// every TryGetReplacementInfo. Each thread count from 1 to 16 runs the same
+// per-thread lookup stream; with --writer, one more thread keeps rewriting
+// records under the writer lock, as RegisterReplacementFont does. Every record
+// a reader gets back must be internally consistent.
+#include "../../SimpleFontHook/hooks/replacement_info_index.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    struct HFONT__ { int unused; };
+    typedef HFONT__* HFONT;
+
+    // ReplacementFontInfo's layout: original handle, a 92-byte LOGFONTW and the
+    // config version. Every field carries the same stamp so a torn read shows.
+    struct Record {
+        HFONT originalFont;
+        uint32_t logfont[23];
+        LONG configVersion;
+    };
+
+    Record MakeRecord(uint32_t stamp) {
+        Record record;
+        record.originalFont = (HFONT)(uintptr_t)stamp;
+        for (uint32_t& word : record.logfont) word = stamp;
+        record.configVersion = (LONG)stamp;
+        return record;
+    }
+
+    bool Consistent(const Record& record) {
+        uint32_t stamp = (uint32_t)(uintptr_t)record.originalFont;
+        for (uint32_t word : record.logfont) {
+            if (word != stamp) return false;
+        }
+        return (uint32_t)record.configVersion == stamp;
+    }
+
+    // GDI-shaped handle values: object type 0x0A, a uniqueness byte and a
+    // 16-bit handle table index.
+    HFONT FontHandle(uint32_t index) {
+        uint32_t uniqueness = (index * 0x9Du + 0x31u) & 0xFF;
+        return (HFONT)(uintptr_t)(0x0A000000u | (uniqueness << 16) | ((0x0400u + index) & 0xFFFF));
+    }
+
+    typedef ReplacementInfoIndex::Table<HFONT, Record> IndexTable;
+
+    std::mutex g_writerMutex;
+    IndexTable* volatile g_index = nullptr;
+    std::vector<IndexTable*> g_retired;
+
+    std::mutex g_baselineMutex;
+    std::unordered_map<HFONT, Record> g_baseline;
+
+    bool IndexLookup(HFONT font, Record* record) {
+        return ReplacementInfoIndex::Find(g_index, font, record);
+    }
+
+    bool BaselineLookup(HFONT font, Record* record) {
+        std::lock_guard<std::mutex> lock(g_baselineMutex);
+        auto it = g_baseline.find(font);
+        if (it == g_baseline.end()) return false;
+        *record = it->second;
+        return true;
+    }
+
+    void FreeIndex() {
+        IndexTable* current = g_index;
+        g_retired.push_back(current);
+        for (IndexTable* table : g_retired) {
+            delete[] table->slots;
+            delete table;
+        }
+        g_retired.clear();
+        g_index = nullptr;
+    }
+
+    void StoreBoth(HFONT font, const Record& record) {
+        {
+            std::lock_guard<std::mutex> lock(g_writerMutex);
+            ReplacementInfoIndex::StoreLocked(g_index, g_retired, font, record);
+        }
+        std::lock_guard<std::mutex> lock(g_baselineMutex);
+        g_baseline[font] = record;
+    }
+
+    struct Options {
+        uint32_t fonts = 512;
+        uint32_t lookups = 2000000;
+        uint32_t missPercent = 10;
+        bool writer = false;
+    };
+
+    // The per-thread stream: `fonts` live handles looked up in a shuffled order,
+    // with `missPercent` of the probes on handles that were never registered
+    // (stock fonts and engine-created fonts the hook left alone).
+    std::vector<HFONT> BuildStream(const Options& options, uint32_t seed) {
+        std::vector<HFONT> stream(4096);
+        uint32_t state = seed * 0x2545F491u + 1;
+        for (HFONT& font : stream) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            bool miss = state % 100 < options.missPercent;
+            uint32_t index = (state >> 8) % options.fonts;
+            font = FontHandle(miss ? options.fonts + index : index);
+        }
+        return stream;
+    }
+
+    struct RunResult {
+        double lookupsPerSecond = 0;
+        uint64_t hits = 0;
+        uint64_t torn = 0;
+    };
+
+    template <typename Lookup>
+    RunResult Run(const Options& options, int threads, Lookup lookup) {
+        std::vector<std::vector<HFONT>> streams;
+        for (int t = 0; t < threads; ++t) streams.push_back(BuildStream(options, (uint32_t)t + 1));
+
+        std::atomic<int> ready(0);
+        std::atomic<bool> go(false);
+        std::atomic<bool> stop(false);
+        std::atomic<uint64_t> hits(0);
+        std::atomic<uint64_t> torn(0);
+
+        std::thread writer;
+        if (options.writer) {
+            writer = std::thread([&]() {
+                uint32_t round = 1;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    for (uint32_t i = 0; i < options.fonts && !stop.load(std::memory_order_relaxed); i += 7)
+                        StoreBoth(FontHandle(i), MakeRecord(round * 0x10000u + i));
+                    ++round;
+                    std::this_thread::yield();
+                }
+            });
+        }
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                const std::vector<HFONT>& stream = streams[(size_t)t];
+                uint64_t localHits = 0;
+                uint64_t localTorn = 0;
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+
+                for (uint32_t i = 0; i < options.lookups; ++i) {
+                    Record record;
+                    if (lookup(stream[i & 4095], &record)) {
+                        ++localHits;
+                        if (!Consistent(record)) ++localTorn;
+                    }
+                }
+                hits.fetch_add(localHits);
+                torn.fetch_add(localTorn);
+            });
+        }
+        while (ready.load() != threads) std::this_thread::yield();
+        auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (std::thread& worker : workers) worker.join();
+        auto end = std::chrono::steady_clock::now();
+        stop.store(true);
+        if (writer.joinable()) writer.join();
+
+        RunResult result;
+        double seconds = std::chrono::duration<double>(end - start).count();
+        result.lookupsPerSecond = (double)options.lookups * threads / seconds;
+        result.hits = hits.load();
+        result.torn = torn.load();
+        return result;
+    }
+
+    bool ParseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--writer") {
+                options.writer = true;
+            } else if (i + 1 < argc && arg == "--fonts") {
+                options.fonts = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            } else if (i + 1 < argc && arg == "--lookups") {
+                options.lookups = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            } else if (i + 1 < argc && arg == "--miss") {
+                options.missPercent = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            } else {
+                return false;
+            }
+        }
+        return options.fonts > 0 && options.fonts <= 0x7000 && options.lookups > 0 && options.missPercent <= 100;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: sfh_replacement_index_bench [--fonts N] [--lookups N] [--miss PERCENT] [--writer]\n");
+        return 2;
+    }
+
+    for (uint32_t i = 0; i < options.fonts; ++i) StoreBoth(FontHandle(i), MakeRecord(i));
+    printf("%u fonts, %u lookups per thread, %u%% misses, writer %s, %u hardware threads\n",
+        options.fonts, options.lookups, options.missPercent, options.writer ? "on" : "off",
+        std::thread::hardware_concurrency());
+    printf("threads  index Mlookup/s  mutex Mlookup/s  speedup\n");
+
+    int failures = 0;
+    for (int threads : { 1, 2, 4, 8, 16 }) {
+        RunResult index = Run(options, threads, IndexLookup);
+        RunResult baseline = Run(options, threads, BaselineLookup);
+        printf("%7d  %15.1f  %15.1f  %6.1fx\n", threads, index.lookupsPerSecond / 1e6,
+            baseline.lookupsPerSecond / 1e6, index.lookupsPerSecond / baseline.lookupsPerSecond);
+        if (index.torn || baseline.torn) {
+            printf("FAIL %d threads: %llu torn index records, %llu torn baseline records\n", threads,
+                (unsigned long long)index.torn, (unsigned long long)baseline.torn);
+            ++failures;
+        }
+        if (!options.writer && index.hits != baseline.hits) {
+            printf("FAIL %d threads: index hit %llu lookups, baseline %llu\n", threads,
+                (unsigned long long)index.hits, (unsigned long long)baseline.hits);
+            ++failures;
+        }
+    }
+    FreeIndex();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,306 @@
+// Benchmark for the content-addressed temporary read file pool behind
+// EngineCommon::CreateTemporaryReadHandle.
+//
+//   g++ -std=c++17 -O2 -o sfh_temp_read_pool_bench tools/temp_read_pool_bench/sfh_temp_read_pool_bench.cpp
+//   ./sfh_temp_read_pool_bench [--opens N] [--overlays N] [--config-changes N] [--dir PATH]
+//
+// The DLL pool is Win32 only, so this is a POSIX model of it with the same
+// limits and steps: an unlinked temporary file stands in for a delete-on-close
+// file, reopening /proc/self/fd/N stands in for ReOpenFile (a new open file
+// description with its own offset), and hash hits are confirmed against 4 MB
+// mmap windows of the pooled file. The baseline writes a fresh temporary file
+// on every open, as CreateTemporaryReadHandle did before pooling.
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+    constexpr size_t kMaxPooledReadFiles = 32;
+    constexpr size_t kPooledCompareWindow = 4u * 1024 * 1024;
+
+    int g_failures = 0;
+    std::string g_tempDirectory = "/tmp";
+    unsigned long long g_bytesWritten = 0;
+
+    void Fail(const std::string& what) {
+        ++g_failures;
+        printf("FAIL %s\n", what.c_str());
+    }
+
+    constexpr size_t kPayloadHashSamples = 512;
+
+    unsigned long long MixPayloadWord(unsigned long long hash, const uint8_t* bytes) {
+        unsigned long long word = 0;
+        memcpy(&word, bytes, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+        return hash ^ (hash >> 29);
+    }
+
+    // Same hash as engine_common.cpp.
+    unsigned long long HashPayload(const uint8_t* bytes, size_t byteCount) {
+        unsigned long long hash = 1469598103934665603ull ^ byteCount;
+        size_t words = byteCount / 8;
+        size_t stride = words > kPayloadHashSamples ? words / kPayloadHashSamples : 1;
+        for (size_t word = 0; word < words; word += stride) hash = MixPayloadWord(hash, bytes + word * 8);
+        if (byteCount >= 8) hash = MixPayloadWord(hash, bytes + byteCount - 8);
+        for (size_t i = words * 8; i < byteCount; ++i) hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash;
+    }
+
+    int CreateDeleteOnCloseFile(const uint8_t* bytes, size_t byteCount) {
+        std::string path = g_tempDirectory + "/sfhXXXXXX";
+        int file = mkstemp(&path[0]);
+        if (file < 0) return -1;
+        unlink(path.c_str());
+        size_t written = 0;
+        while (written < byteCount) {
+            ssize_t step = write(file, bytes + written, byteCount - written);
+            if (step <= 0) {
+                close(file);
+                return -1;
+            }
+            written += (size_t)step;
+        }
+        g_bytesWritten += byteCount;
+        lseek(file, 0, SEEK_SET);
+        return file;
+    }
+
+    int ReopenFile(int file) {
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/self/fd/%d", file);
+        return open(path, O_RDWR);
+    }
+
+    struct PooledReadFile {
+        int file;
+        size_t byteCount;
+        unsigned long long contentHash;
+        unsigned long long lastUse;
+    };
+
+    struct Pool {
+        size_t maxBytes;
+        std::vector<PooledReadFile> entries;
+        size_t bytes = 0;
+        unsigned long long clock = 0;
+    };
+
+    bool PooledReadFileMatches(const PooledReadFile& entry, const uint8_t* bytes, size_t byteCount) {
+        if (entry.byteCount != byteCount) return false;
+        for (size_t offset = 0; offset < byteCount; offset += kPooledCompareWindow) {
+            size_t windowBytes = std::min(kPooledCompareWindow, byteCount - offset);
+            void* view = mmap(nullptr, windowBytes, PROT_READ, MAP_SHARED, entry.file, (off_t)offset);
+            if (view == MAP_FAILED) return false;
+            bool same = memcmp(view, bytes + offset, windowBytes) == 0;
+            munmap(view, windowBytes);
+            if (!same) return false;
+        }
+        return true;
+    }
+
+    void EvictLocked(Pool& pool, size_t incomingBytes) {
+        while (!pool.entries.empty() &&
+            (pool.entries.size() >= kMaxPooledReadFiles || pool.bytes + incomingBytes > pool.maxBytes)) {
+            auto oldest = std::min_element(pool.entries.begin(), pool.entries.end(),
+                [](const PooledReadFile& left, const PooledReadFile& right) {
+                    return left.lastUse < right.lastUse;
+                });
+            pool.bytes -= oldest->byteCount;
+            close(oldest->file);
+            pool.entries.erase(oldest);
+        }
+    }
+
+    void ReleasePool(Pool& pool) {
+        for (PooledReadFile& entry : pool.entries) close(entry.file);
+        pool.entries.clear();
+        pool.bytes = 0;
+    }
+
+    int PooledOpen(Pool& pool, const uint8_t* bytes, size_t byteCount) {
+        if (byteCount == 0 || byteCount > pool.maxBytes) return CreateDeleteOnCloseFile(bytes, byteCount);
+
+        unsigned long long contentHash = HashPayload(bytes, byteCount);
+        for (PooledReadFile& entry : pool.entries) {
+            if (entry.contentHash != contentHash || !PooledReadFileMatches(entry, bytes, byteCount)) continue;
+            int file = ReopenFile(entry.file);
+            if (file >= 0) {
+                entry.lastUse = ++pool.clock;
+                return file;
+            }
+        }
+
+        EvictLocked(pool, byteCount);
+        PooledReadFile entry = {};
+        entry.file = CreateDeleteOnCloseFile(bytes, byteCount);
+        if (entry.file < 0) return -1;
+        int file = ReopenFile(entry.file);
+        if (file < 0) return entry.file;
+        entry.byteCount = byteCount;
+        entry.contentHash = contentHash;
+        entry.lastUse = ++pool.clock;
+        pool.entries.push_back(entry);
+        pool.bytes += byteCount;
+        return file;
+    }
+
+    // --- Workload. ---
+
+    struct Options {
+        uint32_t opens = 3000;
+        uint32_t overlays = 48;
+        uint32_t configChanges = 2;
+    };
+
+    // Two CJK fonts, a handful of web fonts and many small script/table
+    // overlays, opened with a Zipf-like popularity.
+    std::vector<std::vector<uint8_t>> BuildPayloads(const Options& options) {
+        std::vector<size_t> sizes = { 12u << 20, 6u << 20, 900u << 10, 600u << 10 };
+        uint32_t state = 0x9E3779B9u;
+        auto next = [&]() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        };
+        while (sizes.size() < options.overlays) sizes.push_back(2048 + next() % (256u << 10));
+
+        std::vector<std::vector<uint8_t>> payloads(sizes.size());
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            payloads[i].resize(sizes[i]);
+            for (size_t j = 0; j < sizes[i]; j += 4) {
+                uint32_t word = next();
+                memcpy(&payloads[i][j], &word, std::min<size_t>(4, sizes[i] - j));
+            }
+        }
+        return payloads;
+    }
+
+    std::vector<uint32_t> BuildOpenStream(const Options& options, size_t payloadCount) {
+        std::vector<double> cumulative(payloadCount);
+        double sum = 0;
+        for (size_t i = 0; i < payloadCount; ++i) {
+            sum += 1.0 / std::pow((double)(i + 1), 0.9);
+            cumulative[i] = sum;
+        }
+        uint32_t state = 0x2545F491u;
+        std::vector<uint32_t> stream(options.opens);
+        for (uint32_t& pick : stream) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            double target = (double)(state % 1000000) / 1000000.0 * sum;
+            pick = (uint32_t)(std::lower_bound(cumulative.begin(), cumulative.end(), target) - cumulative.begin());
+            pick = std::min<uint32_t>(pick, (uint32_t)payloadCount - 1);
+        }
+        return stream;
+    }
+
+    bool ReadsBack(int file, const std::vector<uint8_t>& payload) {
+        std::vector<uint8_t> head(std::min<size_t>(payload.size(), 4096));
+        ssize_t got = read(file, head.data(), head.size());
+        return got == (ssize_t)head.size() && memcmp(head.data(), payload.data(), head.size()) == 0;
+    }
+
+    struct Result {
+        double usPerOpen;
+        double bytesPerOpen;
+        size_t liveFiles;
+    };
+
+    // Every handle is checked and closed before the next open, as engines do
+    // for fonts and table files; config changes are spread evenly over the run.
+    template <typename Open>
+    Result Run(const Options& options, const std::vector<std::vector<uint8_t>>& payloads,
+        const std::vector<uint32_t>& stream, Open open, Pool* pool) {
+        g_bytesWritten = 0;
+        double totalUs = 0;
+        uint32_t changeEvery = options.configChanges ? options.opens / (options.configChanges + 1) : 0;
+        for (uint32_t i = 0; i < stream.size(); ++i) {
+            if (pool && changeEvery && i > 0 && i % changeEvery == 0) ReleasePool(*pool);
+            const std::vector<uint8_t>& payload = payloads[stream[i]];
+            auto start = std::chrono::steady_clock::now();
+            int file = open(payload);
+            auto end = std::chrono::steady_clock::now();
+            totalUs += std::chrono::duration<double, std::micro>(end - start).count();
+            if (file < 0) {
+                Fail("open failed for payload " + std::to_string(stream[i]));
+                break;
+            }
+            if (!ReadsBack(file, payload)) Fail("content differs for payload " + std::to_string(stream[i]));
+            close(file);
+        }
+        Result result = {};
+        result.usPerOpen = totalUs / stream.size();
+        result.bytesPerOpen = (double)g_bytesWritten / stream.size();
+        result.liveFiles = pool ? pool->entries.size() : 0;
+        return result;
+    }
+
+    bool ParseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            std::string arg = argv[i];
+            if (arg == "--dir") {
+                g_tempDirectory = argv[i + 1];
+                continue;
+            }
+            uint32_t value = (uint32_t)strtoul(argv[i + 1], nullptr, 10);
+            if (arg == "--opens") options.opens = value;
+            else if (arg == "--overlays") options.overlays = value;
+            else if (arg == "--config-changes") options.configChanges = value;
+            else return false;
+        }
+        return argc % 2 == 1 && options.opens > 0 && options.overlays >= 4 && options.overlays <= 1024;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: sfh_temp_read_pool_bench [--opens N] [--overlays N] [--config-changes N] [--dir PATH]\n");
+        return 2;
+    }
+
+    std::vector<std::vector<uint8_t>> payloads = BuildPayloads(options);
+    std::vector<uint32_t> stream = BuildOpenStream(options, payloads.size());
+    unsigned long long totalPayload = 0;
+    for (uint32_t pick : stream) totalPayload += payloads[pick].size();
+    printf("%zu payloads, %u opens, %.0f KB per open on average, %u config changes, temp dir %s\n",
+        payloads.size(), options.opens, totalPayload / 1024.0 / options.opens, options.configChanges,
+        g_tempDirectory.c_str());
+
+    Result baseline = Run(options, payloads, stream, [](const std::vector<uint8_t>& payload) {
+        return CreateDeleteOnCloseFile(payload.data(), payload.size());
+    }, nullptr);
+
+    printf("path             us/open  written/open  pooled files\n");
+    printf("private file  %10.1f  %9.0f KB  %12s\n", baseline.usPerOpen, baseline.bytesPerOpen / 1024, "-");
+    const size_t limits[] = { 128u * 1024 * 1024, 512u * 1024 * 1024 };
+    const char* names[] = { "pool x86", "pool x64" };
+    for (size_t i = 0; i < 2; ++i) {
+        Pool pool;
+        pool.maxBytes = limits[i];
+        Result pooled = Run(options, payloads, stream, [&pool](const std::vector<uint8_t>& payload) {
+            return PooledOpen(pool, payload.data(), payload.size());
+        }, &pool);
+        printf("%-12s  %10.1f  %9.0f KB  %12zu  (%.1fx)\n", names[i], pooled.usPerOpen,
+            pooled.bytesPerOpen / 1024, pooled.liveFiles, baseline.usPerOpen / pooled.usPerOpen);
+        ReleasePool(pool);
+    }
+
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,317 @@
+// Benchmark for the text substitution lookup and its SSE2 skip.
+//
+//   g++ -std=c++17 -O2 -fshort-wchar
+//       -o sfh_text_substitution_bench tools/text_substitution_bench/sfh_text_substitution_bench.cpp
+//   ./sfh_text_substitution_bench [--lines N] [--text script.txt]
+//
+// -fshort-wchar makes wchar_t a UTF-16 unit, as on Windows, so the pair tables
+// and TextSubstitutionPages (both compiled unchanged from the DLL) see the same
+// code units the hooks do. Three loops are measured over the same lines:
+//   binary   the old per-unit binary search over the sorted pairs;
+//   range    the page lookup behind the first SSE2 skip, which only passed
+//            blocks below the table's first mapped unit;
+//   pages    SubstituteRunInPlace, whose skip tests every lane's high byte
+//            against the page index.
+// All three must produce identical text.
+#include "../../SimpleFontHook/hooks/text_substitution_pages.h"
+#include "../../SimpleFontHook/hooks/internal/font_hooks_text_substitution_map.cppinc"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static_assert(sizeof(wchar_t) == 2, "build with -fshort-wchar");
+
+namespace {
+
+    typedef TextSubstitutionPages::Table<TextSubstitutionPair> Table;
+
+    template <size_t PageCount>
+    Table MakeTable(const TextSubstitutionPair* pairs, size_t count,
+        const TextSubstitutionPages::Pages<PageCount>& pages, const char* name) {
+        Table table = { pairs, count, pages.pageIndex, pages.pages, name };
+        return table;
+    }
+
+#define BENCH_PAGES(pairs) \
+    TextSubstitutionPages::Build<TextSubstitutionPages::CountPages(pairs)>(pairs)
+
+    constexpr auto g_jpPages = BENCH_PAGES(g_jpTraditionalTextSubstitutions);
+    constexpr auto g_t2sPages = BENCH_PAGES(g_traditionalToSimplifiedTextSubstitutions);
+    constexpr auto g_s2tPages = BENCH_PAGES(g_simplifiedToTraditionalTextSubstitutions);
+
+#undef BENCH_PAGES
+
+    // --- Baselines. ---
+
+    bool LookupBinary(const Table& table, wchar_t ch, wchar_t* replacement) {
+        if (ch < table.pairs[0].from || ch > table.pairs[table.count - 1].from) return false;
+        size_t lo = 0;
+        size_t hi = table.count;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            wchar_t from = table.pairs[mid].from;
+            if (from < ch) {
+                lo = mid + 1;
+            } else if (from > ch) {
+                hi = mid;
+            } else {
+                *replacement = table.pairs[mid].to;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int SubstituteBinary(const Table& table, wchar_t* text, int length) {
+        int changed = 0;
+        for (int i = 0; i < length; ++i) {
+            wchar_t replacement;
+            if (LookupBinary(table, text[i], &replacement)) {
+                text[i] = replacement;
+                ++changed;
+            }
+        }
+        return changed;
+    }
+
+    int SkipBelowFirstFrom(const Table& table, const wchar_t* text, int start, int length) {
+        const wchar_t firstFrom = table.pairs[0].from;
+        int i = start;
+        const __m128i bias = _mm_set1_epi16((short)0x8000);
+        const __m128i limit = _mm_set1_epi16((short)(firstFrom ^ 0x8000));
+        for (; i + 8 <= length; i += 8) {
+            __m128i units = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(text + i)), bias);
+            if (_mm_movemask_epi8(_mm_cmplt_epi16(units, limit)) != 0xFFFF) break;
+        }
+        while (i < length && text[i] < firstFrom) ++i;
+        return i;
+    }
+
+    int SubstituteRange(const Table& table, wchar_t* text, int length) {
+        int changed = 0;
+        for (int i = SkipBelowFirstFrom(table, text, 0, length); i < length;
+            i = SkipBelowFirstFrom(table, text, i + 1, length)) {
+            wchar_t replacement = TextSubstitutionPages::LookupUnit(table, text[i]);
+            if (replacement) {
+                text[i] = replacement;
+                ++changed;
+            }
+        }
+        return changed;
+    }
+
+    int SubstitutePages(const Table& table, wchar_t* text, int length) {
+        return TextSubstitutionPages::SubstituteRunInPlace(table, text, 0, length);
+    }
+
+    // --- Corpus. ---
+
+    struct Corpus {
+        std::string name;
+        std::vector<wchar_t> units;
+        std::vector<int> lineStarts;    // one past the last line is units.size()
+    };
+
+    struct Random {
+        uint32_t state;
+        uint32_t Next() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+        // glibc's wcslen assumes a 32-bit wchar_t, so sets carry their size.
+        template <size_t N>
+        wchar_t Pick(const wchar_t (&set)[N]) { return set[Next() % (N - 1)]; }
+    };
+
+    // Script-shaped lines: an optional name tag and quotes around the spoken
+    // text, then a mix of the line's character classes. Ideographs come from
+    // the replacement tables half the time so mapped units are not all rare.
+    Corpus BuildSyntheticCorpus(const char* name, bool japanese, uint32_t lines, const Table& ideographSource) {
+        static const wchar_t kJapanesePunctuation[] = L"、。！？…―・ー～「」『』（）";
+        static const wchar_t kChinesePunctuation[] = L"，。！？…—、：；“”‘’（）《》";
+        static const wchar_t kAscii[] = L"0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz []/\\%";
+
+        Corpus corpus;
+        corpus.name = name;
+        Random random = { japanese ? 0x1234567u : 0x7654321u };
+        for (uint32_t line = 0; line < lines; ++line) {
+            corpus.lineStarts.push_back((int)corpus.units.size());
+            if (random.Next() % 3 == 0) {
+                corpus.units.push_back(L'【');
+                for (uint32_t i = 0; i < 2 + random.Next() % 3; ++i)
+                    corpus.units.push_back(ideographSource.pairs[random.Next() % ideographSource.count].from);
+                corpus.units.push_back(L'】');
+                corpus.units.push_back(japanese ? L'「' : L'“');
+            }
+            uint32_t length = 8 + random.Next() % 48;
+            for (uint32_t i = 0; i < length; ++i) {
+                uint32_t roll = random.Next() % 100;
+                wchar_t ch;
+                if (japanese && roll < 45) {
+                    ch = (wchar_t)(0x3041 + random.Next() % 0x56);             // hiragana
+                } else if (japanese && roll < 55) {
+                    ch = (wchar_t)(0x30A1 + random.Next() % 0x56);             // katakana
+                } else if (roll < (japanese ? 70u : 78u)) {
+                    ch = random.Next() % 2
+                        ? ideographSource.pairs[random.Next() % ideographSource.count].from
+                        : (wchar_t)(0x4E00 + random.Next() % 0x5200);
+                } else if (roll < (japanese ? 88u : 92u)) {
+                    ch = japanese ? random.Pick(kJapanesePunctuation) : random.Pick(kChinesePunctuation);
+                } else {
+                    ch = random.Pick(kAscii);
+                }
+                corpus.units.push_back(ch);
+            }
+        }
+        return corpus;
+    }
+
+    // UTF-8 to UTF-16 with one line per text line. Ill-formed bytes become
+    // U+FFFD; supplementary characters become surrogate pairs.
+    bool LoadTextCorpus(const char* path, Corpus& corpus) {
+        FILE* file = fopen(path, "rb");
+        if (!file) return false;
+        std::string bytes;
+        char buffer[65536];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) bytes.append(buffer, read);
+        fclose(file);
+
+        corpus.name = path;
+        bool lineOpen = false;
+        for (size_t i = 0; i < bytes.size();) {
+            unsigned char lead = (unsigned char)bytes[i];
+            uint32_t code = 0xFFFD;
+            size_t extra = lead < 0x80 ? 0 : lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+            if (lead < 0x80) {
+                code = lead;
+            } else if (extra && i + extra < bytes.size()) {
+                code = lead & (0x3F >> extra);
+                for (size_t k = 1; k <= extra; ++k) code = (code << 6) | ((unsigned char)bytes[i + k] & 0x3F);
+            }
+            i += extra + 1;
+
+            if (code == '\n' || code == '\r') {
+                lineOpen = false;
+                continue;
+            }
+            if (!lineOpen) {
+                corpus.lineStarts.push_back((int)corpus.units.size());
+                lineOpen = true;
+            }
+            if (code >= 0x10000 && code <= 0x10FFFF) {
+                code -= 0x10000;
+                corpus.units.push_back((wchar_t)(0xD800 + (code >> 10)));
+                corpus.units.push_back((wchar_t)(0xDC00 + (code & 0x3FF)));
+            } else {
+                corpus.units.push_back((wchar_t)(code > 0xFFFF ? 0xFFFD : code));
+            }
+        }
+        return !corpus.units.empty();
+    }
+
+    // --- Measurement. ---
+
+    template <typename Substitute>
+    double MUnitsPerSecond(const Table& table, const Corpus& corpus, std::vector<wchar_t>& work,
+        Substitute substitute, uint64_t* changed) {
+        size_t total = corpus.units.size();
+        int passes = (int)(40000000 / total) + 1;
+        uint64_t count = 0;
+        double seconds = 0;
+        for (int pass = 0; pass < passes; ++pass) {
+            work = corpus.units;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t line = 0; line < corpus.lineStarts.size(); ++line) {
+                int begin = corpus.lineStarts[line];
+                int end = line + 1 < corpus.lineStarts.size() ? corpus.lineStarts[line + 1] : (int)total;
+                count += (uint64_t)substitute(table, work.data() + begin, end - begin);
+            }
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        *changed = count / (uint64_t)passes;
+        return (double)total * passes / seconds / 1e6;
+    }
+
+    // Share of units the page skip never looks at.
+    double SkippedShare(const Table& table, const Corpus& corpus) {
+        size_t mapped = 0;
+        for (wchar_t ch : corpus.units) mapped += TextSubstitutionPages::IsMappedPage(table, ch);
+        return 100.0 * (double)(corpus.units.size() - mapped) / (double)corpus.units.size();
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t lines = 20000;
+    const char* textPath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--lines") {
+            lines = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && arg == "--text") {
+            textPath = argv[++i];
+        } else {
+            fprintf(stderr, "usage: sfh_text_substitution_bench [--lines N] [--text script.txt]\n");
+            return 2;
+        }
+    }
+    if (lines == 0) lines = 1;
+
+    const Table tables[] = {
+        MakeTable(g_jpTraditionalTextSubstitutions,
+            sizeof(g_jpTraditionalTextSubstitutions) / sizeof(g_jpTraditionalTextSubstitutions[0]),
+            g_jpPages, "jp-traditional"),
+        MakeTable(g_traditionalToSimplifiedTextSubstitutions,
+            sizeof(g_traditionalToSimplifiedTextSubstitutions) / sizeof(g_traditionalToSimplifiedTextSubstitutions[0]),
+            g_t2sPages, "traditional-to-simplified"),
+        MakeTable(g_simplifiedToTraditionalTextSubstitutions,
+            sizeof(g_simplifiedToTraditionalTextSubstitutions) / sizeof(g_simplifiedToTraditionalTextSubstitutions[0]),
+            g_s2tPages, "simplified-to-traditional"),
+    };
+
+    std::vector<Corpus> corpora;
+    if (textPath) {
+        Corpus corpus;
+        if (!LoadTextCorpus(textPath, corpus)) {
+            fprintf(stderr, "cannot read %s\n", textPath);
+            return 2;
+        }
+        corpora.push_back(corpus);
+    } else {
+        corpora.push_back(BuildSyntheticCorpus("synthetic-ja", true, lines, tables[0]));
+        corpora.push_back(BuildSyntheticCorpus("synthetic-zh", false, lines, tables[1]));
+    }
+
+    int failures = 0;
+    std::vector<wchar_t> work;
+    printf("corpus          table                      units  skip%%  binary Mu/s  range Mu/s  pages Mu/s  vs binary\n");
+    for (const Corpus& corpus : corpora) {
+        for (const Table& table : tables) {
+            uint64_t binaryChanged = 0;
+            uint64_t rangeChanged = 0;
+            uint64_t pagesChanged = 0;
+            double binary = MUnitsPerSecond(table, corpus, work, SubstituteBinary, &binaryChanged);
+            std::vector<wchar_t> expected = work;
+            double range = MUnitsPerSecond(table, corpus, work, SubstituteRange, &rangeChanged);
+            bool rangeSame = work == expected;
+            double pages = MUnitsPerSecond(table, corpus, work, SubstitutePages, &pagesChanged);
+            bool pagesSame = work == expected;
+
+            printf("%-15s %-25s %6zu %6.1f %12.1f %11.1f %11.1f %9.2fx\n", corpus.name.c_str(), table.name,
+                corpus.units.size(), SkippedShare(table, corpus), binary, range, pages, pages / binary);
+            if (!rangeSame || !pagesSame || rangeChanged != binaryChanged || pagesChanged != binaryChanged) {
+                printf("FAIL %s/%s: substituted text differs from the binary search\n", corpus.name.c_str(),
+                    table.name);
+                ++failures;
+            }
+        }
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+// Offline decoder for FontHook.trace.bin (DebugTraceBinary=1).
+//
+//   g++ -std=c++17 -O2 -o sfh_trace_decode tools/trace_decode/sfh_trace_decode.cpp
+//   ./sfh_trace_decode [--tsv] FontHook.trace.bin
+//
+// Text output mirrors the sampled text trace; --tsv prints one tab-separated
+// record per line for scripts.
+#include "../../SimpleFontHook/hooks/trace_binary_format.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+    struct DecodedTrace {
+        TraceBinary::FileHeader header;
+        std::vector<std::string> formats;
+        std::vector<TraceBinary::Record> records;
+    };
+
+    bool LoadTrace(const char* path, DecodedTrace& trace, std::string& error) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            error = "cannot open file";
+            return false;
+        }
+        std::vector<char> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        if (data.size() < sizeof(TraceBinary::FileHeader)) {
+            error = "file too small";
+            return false;
+        }
+
+        TraceBinary::FileHeader& header = trace.header;
+        memcpy(&header, data.data(), sizeof(header));
+        if (memcmp(header.magic, TraceBinary::kMagic, sizeof(header.magic)) != 0) {
+            error = "not a FontHook binary trace";
+            return false;
+        }
+        if (header.formatVersion != TraceBinary::kFormatVersion ||
+            header.recordSize != sizeof(TraceBinary::Record) ||
+            header.formatEntrySize != TraceBinary::kFormatEntrySize) {
+            error = "unsupported trace format version";
+            return false;
+        }
+
+        uint64_t formatOffset = header.headerSize;
+        uint64_t recordOffset = formatOffset + (uint64_t)header.formatCapacity * header.formatEntrySize;
+        uint64_t end = recordOffset + (uint64_t)header.recordCapacity * header.recordSize;
+        if (end > data.size() || header.formatCount > header.formatCapacity) {
+            error = "truncated trace file";
+            return false;
+        }
+
+        for (uint32_t i = 0; i < header.formatCount; ++i) {
+            const char* text = data.data() + formatOffset + (uint64_t)i * header.formatEntrySize;
+            trace.formats.emplace_back(text, strnlen(text, header.formatEntrySize));
+        }
+
+        for (uint32_t i = 0; i < header.recordCapacity; ++i) {
+            TraceBinary::Record record;
+            memcpy(&record, data.data() + recordOffset + (uint64_t)i * header.recordSize, sizeof(record));
+            if (record.sequence != 0) trace.records.push_back(record);
+        }
+        std::sort(trace.records.begin(), trace.records.end(),
+            [](const TraceBinary::Record& left, const TraceBinary::Record& right) {
+                return left.sequence < right.sequence;
+            });
+        return true;
+    }
+
+    // Re-applies one printf conversion to a widened argument slot. Length
+    // modifiers are replaced with ll so the slot width is independent of the
+    // producer's ABI; %p follows the MSVC upper-case, zero-padded form.
+    void AppendConversion(std::string& out, const std::string& spec, char conversion, uint64_t value,
+        uint32_t pointerSize) {
+        char buffer[128];
+        if (conversion == 'p') {
+            snprintf(buffer, sizeof(buffer), "%0*" PRIX64, (int)(pointerSize * 2), value);
+        } else {
+            std::string format = spec + "ll" + conversion;
+            if (conversion == 'd' || conversion == 'i')
+                snprintf(buffer, sizeof(buffer), format.c_str(), (long long)value);
+            else
+                snprintf(buffer, sizeof(buffer), format.c_str(), (unsigned long long)value);
+        }
+        out += buffer;
+    }
+
+    std::string FormatDetail(const DecodedTrace& trace, const TraceBinary::Record& record) {
+        if (record.formatId == TraceBinary::kNoFormat) return std::string();
+        if (record.formatId >= trace.formats.size()) return "<unknown format>";
+
+        const std::string& format = trace.formats[record.formatId];
+        std::string out;
+        uint16_t arg = 0;
+        for (size_t i = 0; i < format.size(); ++i) {
+            if (format[i] != '%') {
+                out += format[i];
+                continue;
+            }
+            if (i + 1 < format.size() && format[i + 1] == '%') {
+                out += '%';
+                ++i;
+                continue;
+            }
+
+            // Flags, width and precision are kept; length modifiers are dropped.
+            std::string spec = "%";
+            size_t p = i + 1;
+            while (p < format.size() && strchr("-+ #0123456789.", format[p])) spec += format[p++];
+            if (format.compare(p, 2, "ll") == 0) p += 2;
+            else if (format.compare(p, 3, "I64") == 0) p += 3;
+            else if (p < format.size() && (format[p] == 'l' || format[p] == 'h')) ++p;
+            if (p >= format.size()) break;
+
+            char conversion = format[p];
+            uint64_t value = arg < record.argCount && arg < TraceBinary::kMaxArgs ? record.args[arg] : 0;
+            ++arg;
+            AppendConversion(out, spec, conversion, value, trace.header.pointerSize);
+            i = p;
+        }
+        return out;
+    }
+
+    const char* KindName(const DecodedTrace& trace, uint16_t kind) {
+        if (kind >= trace.header.kindCount || kind >= TraceBinary::kMaxKinds) return "unknown";
+        return trace.header.kindNames[kind];
+    }
+
+    double SecondsSinceStart(const DecodedTrace& trace, const TraceBinary::Record& record) {
+        if (trace.header.qpcFrequency <= 0) return 0.0;
+        return (double)(record.qpc - trace.header.startQpc) / (double)trace.header.qpcFrequency;
+    }
+}
+
+int main(int argc, char** argv) {
+    bool tsv = false;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--tsv") == 0) tsv = true;
+        else path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s [--tsv] FontHook.trace.bin\n", argv[0]);
+        return 2;
+    }
+
+    DecodedTrace trace = {};
+    std::string error;
+    if (!LoadTrace(path, trace, error)) {
+        fprintf(stderr, "%s: %s\n", path, error.c_str());
+        return 1;
+    }
+
+    uint64_t written = trace.header.nextSequence;
+    uint64_t lost = written > trace.records.size() ? written - trace.records.size() : 0;
+    if (tsv) {
+        printf("sequence\tseconds\ttid\tversion\tkind\tdetail\n");
+    } else {
+        printf("# pid=%u records=%zu written=%" PRIu64 " overwritten=%" PRIu64 " formats=%u\n",
+            trace.header.processId, trace.records.size(), written, lost, trace.header.formatCount);
+    }
+
+    for (const TraceBinary::Record& record : trace.records) {
+        std::string detail = FormatDetail(trace, record);
+        double seconds = SecondsSinceStart(trace, record);
+        if (tsv) {
+            printf("%" PRIu64 "\t%.6f\t%u\t%d\t%s\t%s\n", record.sequence, seconds, record.threadId,
+                record.configVersion, KindName(trace, record.kind), detail.c_str());
+        } else {
+            printf("[+%.6f][tid=%u] [TRACE][v%d][%s #%" PRIu64 "] %s\n", seconds, record.threadId,
+                record.configVersion, KindName(trace, record.kind), record.sequence, detail.c_str());
+        }
+    }
+    return 0;
+}